@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <optional>
+
+#include "bruteforce.hpp"
+#include "heuristic.hpp"
+
+#include "anytime.hpp"
+
+namespace {
+
+/// forwards programs to another consumer while remembering the length of the most recent one
+struct LengthTrackingConsumer : public ProgramConsumer {
+    ProgramConsumer &consumer;
+    std::size_t length = 0;
+
+    explicit LengthTrackingConsumer(ProgramConsumer &consumer) noexcept : consumer{consumer} {}
+
+    void operator()(const Instruction *ins, const std::size_t count) final
+    {
+        length = count;
+        consumer(ins, count);
+    }
+};
+
+/// keeps a copy of the most recent program
+struct ProgramBuffer : public ProgramConsumer {
+    Program program;
+
+    explicit ProgramBuffer(const std::size_t variables) noexcept : program{variables} {}
+
+    void operator()(const Instruction *ins, const std::size_t count) final
+    {
+        program.clear();
+        for (std::size_t i = 0; i < count; ++i) {
+            program.push(ins[i]);
+        }
+    }
+};
+
+/// Returns the program with every operation outside of InstructionSet::C replaced by operations of it, so that it is
+/// a valid bound for the search, or nothing if the result would be too long. Constants and moves are kept.
+[[nodiscard]] std::optional<Program> lower_to_instruction_set_c(const Program &program) noexcept
+{
+    // every operation takes at most two instructions of InstructionSet::C
+    if (2 * program.size() > Program::instruction_count) {
+        return std::nullopt;
+    }
+    Program result{program.variables};
+    result.symbols = program.symbols;
+
+    // the operand which holds the result of each instruction of the program
+    std::array<unsigned, Program::instruction_count> results{};
+    const auto operand = [&results](const unsigned x) { return x < 6 ? x : results[x - 6]; };
+    const auto push = [&result](const Op op, const unsigned a, const unsigned b) {
+        result.push(op, a, b);
+        return static_cast<unsigned>(result.size() + 5);
+    };
+    for (std::size_t i = 0; i < program.size(); ++i) {
+        const Instruction ins = program[i];
+        const unsigned a = operand(ins.a);
+        const unsigned b = operand(ins.b);
+        switch (static_cast<Op>(ins.op)) {
+        case Op::NOT_B: results[i] = push(Op::NOT_A, b, 0); break;
+        case Op::NAND: results[i] = push(Op::NOT_A, push(Op::AND, a, b), 0); break;
+        case Op::NOR: results[i] = push(Op::NOT_A, push(Op::OR, a, b), 0); break;
+        case Op::NXOR: results[i] = push(Op::NOT_A, push(Op::XOR, a, b), 0); break;
+        case Op::A_ANDN_B: results[i] = push(Op::AND, a, push(Op::NOT_A, b, 0)); break;
+        case Op::B_ANDN_A: results[i] = push(Op::AND, push(Op::NOT_A, a, 0), b); break;
+        case Op::A_CONS_B: results[i] = push(Op::OR, a, push(Op::NOT_A, b, 0)); break;
+        case Op::B_CONS_A: results[i] = push(Op::OR, push(Op::NOT_A, a, 0), b); break;
+        default: results[i] = push(static_cast<Op>(ins.op), a, b); break;
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+AnytimeResult find_programs_anytime(ProgramConsumer &consumer,
+                                    const TruthTable table,
+                                    const InstructionSet instructionSet,
+                                    const std::size_t variables,
+                                    const Program *const seed,
+                                    const SearchLimits &limits)
+{
+    LengthTrackingConsumer tracking{consumer};
+
+    std::array<Instruction, Program::instruction_count> output_buffer;
+    // a seed with other operations may be shorter than any program of the instruction set, so it is lowered first
+    const std::optional<Program> lowered =
+        seed != nullptr ? lower_to_instruction_set_c(*seed) : std::optional<Program>{};
+    if (lowered.has_value() && not lowered->empty()) {
+        for (std::size_t i = 0; i < lowered->size(); ++i) {
+            output_buffer[i] = (*lowered)[i];
+        }
+        tracking(output_buffer.data(), lowered->size());
+    }
+
+    // the heuristic program only takes a few microseconds and is often a much tighter bound than the seed
+    ProgramBuffer heuristic{variables};
+    find_heuristic_program(heuristic, table, variables);
+    if (tracking.length == 0 || heuristic.program.size() < tracking.length) {
+        for (std::size_t i = 0; i < heuristic.program.size(); ++i) {
+            output_buffer[i] = heuristic.program[i];
+        }
+        tracking(output_buffer.data(), heuristic.program.size());
+    }
+
+    if (tracking.length <= 1) {
+        return {tracking.length, true, 0, tracking.length};
+    }
+    if (find_trivial_program(tracking, table, variables)) {
+        return {tracking.length, true, 0, tracking.length};
+    }
+
+    // lengths beyond what the search supports can't be ruled out
+    constexpr std::size_t max_length = CanonicalProgram::instruction_count;
+    const std::size_t lower_bound = program_length_lower_bound(table, variables);
+
+    std::uint64_t nodes = 0;
+    for (std::size_t length = std::min(tracking.length - 1, max_length); length >= lower_bound; --length) {
+        SearchLimits remaining = limits;
+        remaining.node_budget = limits.node_budget - nodes;
+
+        const SearchResult result =
+            find_equivalent_program_of_length(tracking, table, instructionSet, variables, length, remaining);
+        nodes += result.nodes;
+        if (result.status == SearchStatus::STOPPED) {
+            // the search runs downwards, so the lengths below the stopped one were never ruled out
+            return {tracking.length, false, nodes, lower_bound};
+        }
+    }
+    return {tracking.length, tracking.length <= max_length + 1, nodes, std::min(tracking.length, max_length + 1)};
+}
@@ -0,0 +1,32 @@
+#ifndef ANYTIME_HPP
+#define ANYTIME_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "program.hpp"
+
+struct AnytimeResult {
+    /// the length of the shortest program passed to the consumer
+    std::size_t best_length;
+    /// true if the search ran to completion, meaning that no shorter program exists
+    bool is_optimal;
+    /// the number of nodes visited by the search
+    std::uint64_t nodes;
+    /// a length which no equivalent program can undercut, equal to the best length if it is optimal
+    std::size_t lower_bound;
+};
+
+/// Passes the seed program to the consumer, followed by every strictly shorter program as soon as it is found while
+/// searching downwards from the length of the seed. The search stops once it reaches one of its limits, so there is
+/// always a usable program within a fixed latency.
+/// A seed with operations outside of InstructionSet::C is first rewritten into operations of it, e.g. NAND into AND
+/// followed by NOT. If no seed is given, a heuristic program is used instead.
+AnytimeResult find_programs_anytime(ProgramConsumer &consumer,
+                                    TruthTable table,
+                                    InstructionSet instructionSet,
+                                    std::size_t variables,
+                                    const Program *seed,
+                                    const SearchLimits &limits = {});
+
+#endif  // ANYTIME_HPP
@@ -0,0 +1,586 @@
+// Benchmarks of the search on a corpus of truth tables, and microbenchmarks of its building blocks.
+// The results are printed as JSON, and can be compared against the results of an earlier run, so that regressions
+// in throughput fail the benchmark.
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "bruteforce.hpp"
+#include "compiler.hpp"
+#include "lexer.hpp"
+#include "ordering.hpp"
+#include "program.hpp"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct BenchOptions {
+    std::string output_path;
+    std::string baseline_path;
+    /// the name prefix of the benchmarks which are run, all of them if empty
+    std::string filter;
+    /// the slowdown in percent above which a benchmark counts as regressed
+    double tolerance = 10;
+    /// the nodes after which the search for a single table gives up
+    std::uint64_t node_budget = std::uint64_t{1} << 20;
+    /// how often every table is searched, of which the fastest search is measured
+    unsigned repetitions = 3;
+};
+
+/// a table of the corpus, with the number of variables it is searched with
+struct CorpusEntry {
+    std::uint64_t table;
+    std::size_t variables;
+};
+
+struct CorpusGroup {
+    std::vector<CorpusEntry> entries;
+    /// the order in which the search tries candidates, the usual order if empty
+    std::optional<MoveOrdering> ordering = std::nullopt;
+};
+
+/// A group of the corpus, which is only made when the group is run, since some groups take long to make.
+struct CorpusSource {
+    const char *name;
+    CorpusGroup (*make)();
+};
+
+/// The measurements of one benchmark, written as one JSON object.
+/// Only metrics which are robust against outliers are compared against the baseline: nodes per second for searches,
+/// where higher is better, measured with the fastest of the repeated searches of every table, and the nanoseconds
+/// per operation of the fastest batch of microbenchmarks, where lower is better.
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, double>> metrics;
+
+    void add(std::string key, const double value)
+    {
+        metrics.emplace_back(std::move(key), value);
+    }
+};
+
+class NullConsumer final : public ProgramConsumer {
+public:
+    void operator()(const Instruction *, std::size_t) final {}
+};
+
+[[nodiscard]] long peak_rss_kib() noexcept
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/// Returns the given percentile of the sorted samples, with the nearest rank method.
+[[nodiscard]] double percentile(const std::vector<double> &sorted, const double p) noexcept
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    const auto rank = static_cast<std::size_t>(p / 100 * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+void add_percentiles(BenchResult &result, std::vector<double> samples, const char *const unit)
+{
+    std::sort(samples.begin(), samples.end());
+    for (const int p : {50, 90, 99}) {
+        result.add("p" + std::to_string(p) + '_' + unit, percentile(samples, p));
+    }
+    result.add(std::string{"max_"} + unit, samples.empty() ? 0 : samples.back());
+}
+
+// CORPUS ==============================================================================================================
+
+/// Returns the table of a function of the number of true variables of each row.
+template <typename F>
+[[nodiscard]] std::uint64_t symmetric_table(const std::size_t variables, F f) noexcept
+{
+    std::uint64_t result = 0;
+    for (std::uint64_t row = 0; row < std::uint64_t{1} << variables; ++row) {
+        result |= std::uint64_t{f(popcount(row))} << row;
+    }
+    return result;
+}
+
+/// Returns the table of a multiplexer, whose first select variables choose which of the remaining ones is the result.
+[[nodiscard]] std::uint64_t mux_table(const std::size_t select) noexcept
+{
+    const std::size_t variables = select + (std::size_t{1} << select);
+    std::uint64_t result = 0;
+    for (std::uint64_t row = 0; row < std::uint64_t{1} << variables; ++row) {
+        const std::uint64_t chosen = row & ((std::uint64_t{1} << select) - 1);
+        result |= (row >> (select + chosen) & 1) << row;
+    }
+    return result;
+}
+
+/// Returns the 4-variable table with permuted, negated inputs, where the permutation maps input i to perm[i].
+[[nodiscard]] std::uint64_t transform_table4(const std::uint64_t table,
+                                             const std::array<unsigned, 4> &perm,
+                                             const unsigned negation) noexcept
+{
+    std::uint64_t result = 0;
+    for (unsigned row = 0; row < 16; ++row) {
+        unsigned source = 0;
+        for (unsigned i = 0; i < 4; ++i) {
+            source |= (row >> perm[i] & 1) << i;
+        }
+        result |= (table >> (source ^ negation) & 1) << row;
+    }
+    return result;
+}
+
+/// Returns one representative of every class of 4-variable functions which are equivalent under negation of inputs,
+/// permutation of inputs, and negation of the output.
+[[nodiscard]] std::vector<CorpusEntry> npn_representatives4()
+{
+    std::vector<std::array<unsigned, 4>> permutations;
+    std::array<unsigned, 4> perm{0, 1, 2, 3};
+    do {
+        permutations.push_back(perm);
+    } while (std::next_permutation(perm.begin(), perm.end()));
+
+    std::vector<CorpusEntry> result;
+    std::vector<bool> seen(1 << 16);
+    for (std::uint64_t table = 0; table < seen.size(); ++table) {
+        if (seen[table]) {
+            continue;
+        }
+        result.push_back({table, 4});
+        for (const std::array<unsigned, 4> &p : permutations) {
+            for (unsigned negation = 0; negation < 16; ++negation) {
+                const std::uint64_t transformed = transform_table4(table, p, negation);
+                seen[transformed] = true;
+                seen[~transformed & 0xffff] = true;
+            }
+        }
+    }
+    return result;
+}
+
+[[nodiscard]] std::vector<TruthTable> all3_tables()
+{
+    std::vector<TruthTable> result;
+    for (std::uint64_t table = 0; table < 256; ++table) {
+        result.push_back({table, table});
+    }
+    return result;
+}
+
+[[nodiscard]] CorpusGroup make_all3()
+{
+    CorpusGroup result;
+    for (std::uint64_t table = 0; table < 256; ++table) {
+        result.entries.push_back({table, 3});
+    }
+    return result;
+}
+
+[[nodiscard]] CorpusGroup make_npn4()
+{
+    return {npn_representatives4()};
+}
+
+/// the tables of npn4 with candidates ordered, and operations in the order learned from the smaller functions
+[[nodiscard]] CorpusGroup make_npn4_ordered()
+{
+    return {npn_representatives4(), MoveOrdering{learn_op_order(all3_tables(), InstructionSet::C, 3)}};
+}
+
+// functions which are known to need long programs, and long searches to prove them optimal
+
+[[nodiscard]] CorpusGroup make_hard5()
+{
+    return {{
+        {symmetric_table(5, [](const int n) { return n % 2 == 1; }), 5},
+        {symmetric_table(5, [](const int n) { return n >= 3; }), 5},
+        {symmetric_table(5, [](const int n) { return n == 2; }), 5},
+        {symmetric_table(5, [](const int n) { return n == 1 || n == 4; }), 5},
+    }};
+}
+
+[[nodiscard]] CorpusGroup make_hard6()
+{
+    return {{
+        {symmetric_table(6, [](const int n) { return n % 2 == 1; }), 6},
+        {symmetric_table(6, [](const int n) { return n >= 3; }), 6},
+        {symmetric_table(6, [](const int n) { return n == 3; }), 6},
+        {mux_table(2), 6},
+    }};
+}
+
+constexpr CorpusSource CORPUS[] = {
+    {"search/all3", make_all3},
+    {"search/npn4", make_npn4},
+    {"search/npn4-ordered", make_npn4_ordered},
+    {"search/hard5", make_hard5},
+    {"search/hard6", make_hard6},
+};
+
+[[nodiscard]] BenchResult run_corpus_group(const char *const name,
+                                           const CorpusGroup &group,
+                                           const BenchOptions &options)
+{
+    NullConsumer consumer;
+    SearchLimits limits;
+    limits.node_budget = options.node_budget;
+    SearchOptions search;
+    search.ordering = group.ordering.has_value() ? &*group.ordering : nullptr;
+
+    std::vector<double> latencies;
+    std::uint64_t nodes = 0;
+    std::uint64_t stopped = 0;
+    std::chrono::nanoseconds elapsed{};
+    for (const CorpusEntry &entry : group.entries) {
+        const TruthTable table{entry.table, entry.table};
+        // the search is deterministic, so only its time differs between the repetitions
+        SearchResult result{};
+        auto duration = clock_type::duration::max();
+        for (unsigned repetition = 0; repetition < options.repetitions; ++repetition) {
+            const auto start = clock_type::now();
+            result =
+                find_equivalent_programs(consumer, table, InstructionSet::C, entry.variables, false, limits, search);
+            duration = std::min(duration, clock_type::now() - start);
+        }
+
+        elapsed += duration;
+        nodes += result.nodes;
+        stopped += result.status == SearchStatus::STOPPED;
+        latencies.push_back(std::chrono::duration<double, std::micro>(duration).count());
+    }
+
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    BenchResult result{name, {}};
+    result.add("cases", static_cast<double>(group.entries.size()));
+    result.add("stopped", static_cast<double>(stopped));
+    result.add("nodes", static_cast<double>(nodes));
+    result.add("nodes_per_second", seconds == 0 ? 0 : static_cast<double>(nodes) / seconds);
+    add_percentiles(result, std::move(latencies), "us");
+    return result;
+}
+
+// MICROBENCHMARKS =====================================================================================================
+
+/// the sum of all results of the microbenchmarks, which keeps the compiler from optimizing them away
+volatile std::uint64_t sink;
+
+/// Runs the operation in batches until enough time has passed, and measures the time per operation of each batch.
+/// The mean is reported as ns_per_op, the fastest batch as min_ns.
+template <typename F>
+[[nodiscard]] BenchResult run_micro(const char *const name, F f)
+{
+    constexpr std::size_t batches = 64;
+    constexpr auto min_batch_time = std::chrono::milliseconds{2};
+
+    // grow the batch until it is long enough to be timed accurately
+    std::uint64_t batch_size = 1;
+    while (true) {
+        const auto start = clock_type::now();
+        for (std::uint64_t i = 0; i < batch_size; ++i) {
+            sink = sink + f();
+        }
+        if (clock_type::now() - start >= min_batch_time) {
+            break;
+        }
+        batch_size *= 2;
+    }
+
+    std::vector<double> samples;
+    std::chrono::nanoseconds elapsed{};
+    for (std::size_t batch = 0; batch < batches; ++batch) {
+        const auto start = clock_type::now();
+        for (std::uint64_t i = 0; i < batch_size; ++i) {
+            sink = sink + f();
+        }
+        const auto duration = clock_type::now() - start;
+        elapsed += duration;
+        samples.push_back(std::chrono::duration<double, std::nano>(duration).count() /
+                          static_cast<double>(batch_size));
+    }
+
+    const double iterations = static_cast<double>(batches * batch_size);
+    BenchResult result{name, {}};
+    result.add("iterations", iterations);
+    result.add("ns_per_op", std::chrono::duration<double, std::nano>(elapsed).count() / iterations);
+    result.add("min_ns", *std::min_element(samples.begin(), samples.end()));
+    add_percentiles(result, std::move(samples), "ns");
+    return result;
+}
+
+constexpr std::string_view MICRO_EXPRESSION =
+    "((a & b) | (~c ^ d)) & ((e | ~f) ^ (a & ~d)) | ~(b ^ (c & f)) & (d | (e ^ ~a)) ^ ((f & ~b) | (c ^ e))";
+
+/// a program in the middle of a search, on which candidate instructions are tested
+[[nodiscard]] CanonicalProgram make_micro_program() noexcept
+{
+    CanonicalProgram program{8, 0b111111};
+    program.try_push(Op::NOT_A, 4);
+    program.try_push(Op::AND, 3, 6);
+    program.try_push(Op::XOR, 2, 7);
+    program.try_push(Op::NOT_A, 8);
+    program.try_push(Op::AND, 1, 9);
+    return program;
+}
+
+[[nodiscard]] std::vector<BenchResult> run_micros(const BenchOptions &options)
+{
+    const auto selected = [&](const std::string_view name) {
+        return name.compare(0, options.filter.size(), options.filter) == 0;
+    };
+    std::vector<BenchResult> results;
+
+    if (selected("micro/tokenize")) {
+        results.push_back(run_micro("micro/tokenize", [] { return tokenize(MICRO_EXPRESSION)->tokens.size(); }));
+    }
+    if (selected("micro/compile")) {
+        const TokenList tokens = *tokenize(MICRO_EXPRESSION);
+        results.push_back(run_micro("micro/compile", [&] {
+            return compile(tokens, SymbolOrder::LEX_ASCENDING)->size();
+        }));
+    }
+    if (selected("micro/can_push")) {
+        const CanonicalProgram program = make_micro_program();
+        const unsigned operands = static_cast<unsigned>(program.size() + VARIABLE_COUNT);
+        // one operation tests every binary candidate on the program
+        results.push_back(run_micro("micro/can_push", [&] {
+            std::uint64_t accepted = 0;
+            for (const Op op : {Op::AND, Op::OR, Op::XOR}) {
+                for (unsigned a = 0; a < operands; ++a) {
+                    for (unsigned b = a + 1; b < operands; ++b) {
+                        accepted += can_push<false>(program, op, a, b).has_value();
+                    }
+                }
+            }
+            return accepted;
+        }));
+    }
+    if (selected("micro/emulate_leaf")) {
+        const CanonicalProgram program = make_micro_program();
+        const std::uint64_t computed = program_emulate<TruthTableMode::FIND>(program, 6u);
+        const TruthTable table{computed, computed};
+        results.push_back(run_micro("micro/emulate_leaf", [&] {
+            return program_emulate<TruthTableMode::TEST>(program, 6u, table);
+        }));
+    }
+    return results;
+}
+
+// OUTPUT ==============================================================================================================
+
+void write_results(std::ostream &out, const std::vector<BenchResult> &results)
+{
+    const std::streamsize precision = out.precision(12);
+    out << "{\"peak_rss_kib\":" << peak_rss_kib() << ",\"benchmarks\":[";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        out << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << results[i].name << '"';
+        for (const auto &[key, value] : results[i].metrics) {
+            out << ",\"" << key << "\":" << value;
+        }
+        out << '}';
+    }
+    out << "\n]}\n";
+    out.precision(precision);
+}
+
+/// Reads the benchmarks of an earlier run, which is expected to be written by write_results.
+/// Only the numeric metrics of every benchmark are read, by name.
+[[nodiscard]] std::map<std::string, std::map<std::string, double>> read_results(const std::string_view json)
+{
+    std::map<std::string, std::map<std::string, double>> result;
+    constexpr std::string_view name_key = "{\"name\":\"";
+    for (std::size_t pos = json.find(name_key); pos != std::string_view::npos; pos = json.find(name_key, pos)) {
+        pos += name_key.size();
+        const std::size_t name_end = json.find('"', pos);
+        const std::size_t object_end = json.find('}', pos);
+        if (name_end == std::string_view::npos || object_end == std::string_view::npos) {
+            break;
+        }
+        std::map<std::string, double> &metrics = result[std::string{json.substr(pos, name_end - pos)}];
+
+        // the rest of the object is a sequence of ,"key":number
+        std::size_t key_begin = json.find(",\"", name_end);
+        while (key_begin < object_end) {
+            const std::size_t key_end = json.find("\":", key_begin + 2);
+            const std::size_t value_end = std::min(json.find(',', key_end), object_end);
+            const std::string value{json.substr(key_end + 2, value_end - key_end - 2)};
+            metrics[std::string{json.substr(key_begin + 2, key_end - key_begin - 2)}] = std::strtod(value.c_str(), nullptr);
+            key_begin = value_end;
+        }
+        pos = object_end;
+    }
+    return result;
+}
+
+/// Compares the throughput of every benchmark to the baseline, and returns the number of regressions.
+[[nodiscard]] std::size_t compare_results(std::ostream &out,
+                                          const std::vector<BenchResult> &results,
+                                          const std::map<std::string, std::map<std::string, double>> &baseline,
+                                          const double tolerance)
+{
+    std::size_t regressions = 0;
+    for (const BenchResult &result : results) {
+        const auto entry = baseline.find(result.name);
+        if (entry == baseline.end()) {
+            out << result.name << ": not in baseline\n";
+            continue;
+        }
+        for (const auto &[key, value] : result.metrics) {
+            const bool higher_is_better = key == "nodes_per_second";
+            if (not higher_is_better && key != "min_ns") {
+                continue;
+            }
+            const auto old_value = entry->second.find(key);
+            if (old_value == entry->second.end() || old_value->second == 0 || value == 0) {
+                continue;
+            }
+            // the slowdown in percent, negative for a speedup
+            const double ratio = higher_is_better ? old_value->second / value : value / old_value->second;
+            const double slowdown = (ratio - 1) * 100;
+            const bool regressed = slowdown > tolerance;
+            regressions += regressed;
+            out << result.name << ": " << key << ' ' << old_value->second << " -> " << value << " ("
+                << (slowdown > 0 ? "+" : "") << slowdown << "% time)" << (regressed ? " REGRESSION\n" : "\n");
+        }
+    }
+    return regressions;
+}
+
+// COMMAND LINE ========================================================================================================
+
+void print_help(std::ostream &out)
+{
+    out << "Usage: boolexpr_bench [OPTIONS]\n"
+           "\n"
+           "    --output FILE        write the results to a file instead of stdout\n"
+           "    --baseline FILE      compare the results to those of an earlier run, fail on regressions\n"
+           "    --tolerance PERCENT  allowed slowdown against the baseline (default 10)\n"
+           "    --node-budget NODES  give up on a table after visiting some nodes (default 1048576)\n"
+           "    --repetitions N      search every table N times and measure the fastest search (default 3)\n"
+           "    --filter PREFIX      only run benchmarks whose name starts with the prefix\n";
+}
+
+template <typename T>
+[[nodiscard]] bool parse_number(const std::string_view str, T &out) noexcept
+{
+    if constexpr (std::is_floating_point_v<T>) {
+        char *end = nullptr;
+        const std::string copy{str};
+        out = static_cast<T>(std::strtod(copy.c_str(), &end));
+        return not copy.empty() && *end == '\0';
+    }
+    else {
+        const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), out);
+        return ec == std::errc{} && end == str.data() + str.size();
+    }
+}
+
+[[nodiscard]] bool parse_args(BenchOptions &options, const int argc, char **const argv)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_help(std::cout);
+            std::exit(0);
+        }
+        if (i + 1 == argc) {
+            std::cerr << "Unknown option or missing value: " << arg << '\n';
+            return false;
+        }
+        const std::string_view value = argv[++i];
+        bool valid = true;
+        if (arg == "--output") {
+            options.output_path = value;
+        }
+        else if (arg == "--baseline") {
+            options.baseline_path = value;
+        }
+        else if (arg == "--filter") {
+            options.filter = value;
+        }
+        else if (arg == "--tolerance") {
+            valid = parse_number(value, options.tolerance);
+        }
+        else if (arg == "--node-budget") {
+            valid = parse_number(value, options.node_budget);
+        }
+        else if (arg == "--repetitions") {
+            valid = parse_number(value, options.repetitions) && options.repetitions != 0;
+        }
+        else {
+            std::cerr << "Unknown option: " << arg << '\n';
+            return false;
+        }
+        if (not valid) {
+            std::cerr << "Invalid value for " << arg << ": " << value << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (not parse_args(options, argc, argv)) {
+        print_help(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    std::map<std::string, std::map<std::string, double>> baseline;
+    if (not options.baseline_path.empty()) {
+        std::ifstream in{options.baseline_path};
+        if (not in) {
+            std::cerr << "Failed to open \"" << options.baseline_path << "\"\n";
+            return EXIT_FAILURE;
+        }
+        std::stringstream contents;
+        contents << in.rdbuf();
+        baseline = read_results(contents.str());
+    }
+
+    std::vector<BenchResult> results = run_micros(options);
+    for (const CorpusSource &source : CORPUS) {
+        if (std::string_view{source.name}.compare(0, options.filter.size(), options.filter) == 0) {
+            const CorpusGroup group = source.make();
+            std::cerr << "Running " << source.name << " (" << group.entries.size() << " tables)\n";
+            results.push_back(run_corpus_group(source.name, group, options));
+        }
+    }
+
+    if (options.output_path.empty()) {
+        write_results(std::cout, results);
+    }
+    else {
+        std::ofstream out{options.output_path};
+        if (not out) {
+            std::cerr << "Failed to open \"" << options.output_path << "\" for writing\n";
+            return EXIT_FAILURE;
+        }
+        write_results(out, results);
+    }
+
+    if (not options.baseline_path.empty()) {
+        const std::size_t regressions = compare_results(std::cerr, results, baseline, options.tolerance);
+        if (regressions != 0) {
+            std::cerr << regressions << " regressions beyond " << options.tolerance << "%\n";
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
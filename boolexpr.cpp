@@ -0,0 +1,83 @@
+#include <string>
+
+#include "boolexpr.hpp"
+
+namespace boolexpr {
+
+namespace {
+
+/// copies every program into a vector
+struct CollectingConsumer : public ProgramConsumer {
+    Program prototype;
+    std::vector<Program> programs;
+
+    explicit CollectingConsumer(Program prototype) noexcept : prototype{std::move(prototype)}
+    {
+        this->prototype.clear();
+    }
+
+    void operator()(const Instruction *ins, const std::size_t count) final
+    {
+        Program &program = programs.emplace_back(prototype);
+        for (std::size_t i = 0; i < count; ++i) {
+            program.push(ins[i]);
+        }
+    }
+};
+
+[[nodiscard]] Synthesis synthesize_like(const Program &prototype,
+                                        const TruthTable table,
+                                        const SynthesisOptions &options)
+{
+    CollectingConsumer consumer{prototype};
+    const SearchResult result = find_equivalent_programs(
+        consumer, table, InstructionSet::C, prototype.variables, options.greedy, options.limits);
+    return {std::move(consumer.programs), result.found() && result.complete, result.length, result.lower_bound};
+}
+
+}  // namespace
+
+Result<Table> parse_table(const std::string_view text)
+{
+    std::string digits;
+    digits.reserve(text.size());
+    for (const char c : text) {
+        if (c != '.') {
+            digits += c;
+        }
+    }
+    Result<TruthTable> table = TruthTable::try_parse(digits);
+    if (not table.has_value()) {
+        return table.error();
+    }
+    return Table{*table, log2floor(digits.size())};
+}
+
+Result<Program> compile_expression(const std::string_view expression, const SymbolOrder order)
+{
+    Result<TokenList> tokens = tokenize(expression);
+    if (not tokens.has_value()) {
+        return tokens.error();
+    }
+    return compile(*tokens, order);
+}
+
+Result<Synthesis> synthesize(const Table &table, const SynthesisOptions &options)
+{
+    if (table.variables == 0 || table.variables > VARIABLE_COUNT) {
+        return Error{ErrorCode::UNSUPPORTED,
+                     "Tables must have between 1 and " + std::to_string(VARIABLE_COUNT) + " variables"};
+    }
+    return synthesize_like(Program{table.variables}, table.table, options);
+}
+
+Result<Synthesis> synthesize_expression(const std::string_view expression, const SynthesisOptions &options)
+{
+    Result<Program> program = compile_expression(expression);
+    if (not program.has_value()) {
+        return program.error();
+    }
+    return synthesize_like(*program, program->compute_truth_table(), options);
+}
+
+}  // namespace boolexpr
@@ -0,0 +1,82 @@
+#ifndef BOOLEXPR_HPP
+#define BOOLEXPR_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "compiler.hpp"
+#include "evaluate.hpp"
+#include "jit.hpp"
+#include "program.hpp"
+#include "result.hpp"
+#include "static_synthesis.hpp"
+#include "truth_table.hpp"
+
+/// The embeddable interface of libboolexpr.
+/// No function in here prints anything or exits the process, failures are returned as an Error instead.
+namespace boolexpr {
+
+/// a truth table together with the number of its variables
+struct Table {
+    TruthTable table;
+    std::size_t variables;
+};
+
+struct SynthesisOptions {
+    /// find all shortest programs instead of only the first one
+    bool greedy = false;
+    SearchLimits limits;
+};
+
+struct Synthesis {
+    /// the shortest programs which were found, in the order in which they were found
+    std::vector<Program> programs;
+    /// false if the search stopped at one of its limits before it could finish, even if it found some programs
+    bool complete = true;
+    /// the length of the programs, or the length being searched when the search stopped
+    std::size_t length = 0;
+    /// a length which no equivalent program can undercut, equal to the length if the search is complete
+    std::size_t lower_bound = 0;
+};
+
+/// Parses a truth table of '0', '1' and don't cares, where '.' may be used to group digits.
+[[nodiscard]] Result<Table> parse_table(std::string_view text);
+
+/// Compiles an expression of at most six variables into a program.
+[[nodiscard]] Result<Program> compile_expression(std::string_view expression,
+                                                 SymbolOrder order = SymbolOrder::LEX_ASCENDING);
+
+/// Finds the shortest programs equivalent to the table.
+[[nodiscard]] Result<Synthesis> synthesize(const Table &table, const SynthesisOptions &options = {});
+
+/// Finds the shortest programs equivalent to the expression, which use the symbols of the expression.
+[[nodiscard]] Result<Synthesis> synthesize_expression(std::string_view expression,
+                                                      const SynthesisOptions &options = {});
+
+/// Finds a shortest program for a fully specified table during constant evaluation, so that
+///
+///     constexpr auto majority = boolexpr::synthesize<0xe8, 3>();
+///
+/// is an optimal evaluator without any run time cost. Bit i of the table is the result for the assignment in which
+/// variable v has the value of bit v of i.
+/// The search is bound by the limits of the compiler on constant evaluation, which suffice for most functions of up to
+/// four variables, possibly after raising -fconstexpr-ops-limit (GCC) or -fconstexpr-steps (Clang). The hardest ones,
+/// such as 0x1668 with four variables, exceed the default limit of GCC.
+template <std::uint64_t Table, std::size_t Variables>
+[[nodiscard]] constexpr StaticProgram<Variables> synthesize() noexcept
+{
+    static_assert(Variables >= 1 && Variables <= VARIABLE_COUNT, "programs have between 1 and 6 variables");
+    static_assert((Table & ~truth_table_rows(Variables)) == 0, "the table has more rows than the variables allow");
+    return StaticProgramFinder<Variables>{TruthTable{Table, Table}}.find();
+}
+
+static_assert(synthesize<0xe8, 3>().size() == 4, "majority takes four instructions");
+static_assert((synthesize<0xe8, 3>()(std::array<std::uint64_t, 3>{0xaa, 0xcc, 0xf0}) & 0xff) == 0xe8);
+static_assert(synthesize<0x6996, 4>().size() == 3, "parity takes three instructions");
+static_assert((synthesize<0x6996, 4>()(std::array<std::uint64_t, 4>{0xaaaa, 0xcccc, 0xf0f0, 0xff00}) & 0xffff) ==
+              0x6996);
+
+}  // namespace boolexpr
+
+#endif  // BOOLEXPR_HPP
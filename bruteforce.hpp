@@ -1,8 +1,11 @@
 #ifndef BRUTEFORCE_HPP
 #define BRUTEFORCE_HPP
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <optional>
+#include <type_traits>
 
 #include "program.hpp"
 
@@ -49,7 +52,7 @@ protected:
     state_type target_relevancy_;
 
 public:
-    explicit CanonicalProgram(const size_type target_length, const state_type target_relevancy) noexcept
+    constexpr explicit CanonicalProgram(const size_type target_length, const state_type target_relevancy) noexcept
         : target_length_{target_length}, target_relevancy_{target_relevancy}
     {
     }
@@ -59,47 +62,48 @@ public:
     using base_type::operator[];
     using base_type::top;
 
-    state_type used_instructions() const noexcept
+    constexpr state_type used_instructions() const noexcept
     {
         return used;
     }
 
-    state_type target_relevancy() const noexcept
+    constexpr state_type target_relevancy() const noexcept
     {
         return target_relevancy_;
     }
 
-    state_type target_length() const noexcept
+    constexpr state_type target_length() const noexcept
     {
         return target_length_;
     }
 
-    bool try_push(const Op op, const unsigned a) noexcept;
+    constexpr bool try_push(const Op op, const unsigned a) noexcept;
 
-    bool try_push(const Op op, const unsigned a, const unsigned b) noexcept;
+    constexpr bool try_push(const Op op, const unsigned a, const unsigned b) noexcept;
 
-    void reset(const size_type target_length) noexcept
+    constexpr void reset(const size_type target_length) noexcept
     {
         clear();
         this->target_length_ = target_length;
         this->used = 0;
     }
 
-    void clear() noexcept
+    constexpr void clear() noexcept
     {
         used = 0;
         base_type::clear();
     }
 
-    void push(const instruction_type ins) noexcept
+    constexpr void push(const instruction_type ins) noexcept
     {
         used |= state_type{1} << ins.a | state_type{1} << ins.b;
         base_type::push(ins);
     }
 
-    void pop() noexcept
+    constexpr void pop() noexcept
     {
-        const size_type new_length = std::exchange(length, 0) - 1;
+        const size_type new_length = length - 1;
+        length = 0;
         used = 0;
         for (size_type i = 0; i < new_length; ++i) {
             push(instructions[i]);
@@ -107,4 +111,358 @@ public:
     }
 };
 
+// the rules which only let canonical programs be pushed, so that every program is searched at most once
+
+[[nodiscard]] constexpr std::uint8_t distance_from_inputs(const CanonicalProgram &program,
+                                                     const unsigned operand) noexcept
+{
+    return operand < VARIABLE_COUNT ? 0 : program[operand - VARIABLE_COUNT].distance;
+}
+
+[[nodiscard]] constexpr bool is_breaking_canonical_dag_order(const CanonicalProgram &program,
+                                                             const CanonicalInstruction ins) noexcept
+{
+    // 1.1 enforce ascending order of distance from inputs of instructions
+    if (ins.distance < program.top().distance) {
+        return true;
+    }
+
+    // 1.2 enforce ascending order of instructions (as integral) for equally distant instructions
+    return ins.distance == program.top().distance && ins.to_integral() < program.top().to_integral();
+}
+
+[[nodiscard]] constexpr bool is_double_negation(const CanonicalProgram &program,
+                                                const CanonicalInstruction ins) noexcept
+{
+    return static_cast<Op>(ins.op) == Op::NOT_A && ins.a >= VARIABLE_COUNT &&
+           static_cast<Op>(program[ins.a - VARIABLE_COUNT].op) == Op::NOT_A;
+}
+
+[[nodiscard]] constexpr bool contains(const CanonicalProgram &program, const CanonicalInstruction ins) noexcept
+{
+    for (std::size_t i = 0; i < program.size(); ++i) {
+        if (program[i] == ins) {
+            return true;
+        }
+    }
+    return false;
+}
+
+[[nodiscard]] constexpr bool are_complement_of_same_input(const CanonicalProgram &program,
+                                                          unsigned a,
+                                                          unsigned b) noexcept
+{
+    // FIXME given operand generation, can b ever be lower than a ? (probably not)
+    swap_if(a, b, b < a);
+    if (b < VARIABLE_COUNT) {
+        return false;
+    }
+    const CanonicalInstruction ins = program[b - 6];
+    return static_cast<Op>(ins.op) == Op::NOT_A && program[b - 6].a == a;
+}
+
+[[nodiscard]] constexpr bool is_using_operand(const CanonicalProgram &program,
+                                              const std::uint8_t operand,
+                                              const CanonicalInstruction ins) noexcept
+{
+    const auto check_use = [&program, operand](std::uint8_t other) {
+        return other == operand ||
+               (other >= VARIABLE_COUNT && is_using_operand(program, operand, program[other - VARIABLE_COUNT]));
+    };
+
+    return check_use(ins.a) || (not op_is_unary(static_cast<Op>(ins.op)) && check_use(ins.b));
+}
+
+[[nodiscard]] constexpr bool is_suboptimal_and_or(const CanonicalProgram &program,
+                                                  const CanonicalInstruction ins) noexcept
+{
+    const auto op = static_cast<Op>(ins.op);
+    return (op == Op::AND || op == Op::OR) && ins.b >= VARIABLE_COUNT &&
+           is_using_operand(program, ins.a, program[ins.b - VARIABLE_COUNT]);
+}
+
+[[nodiscard]] constexpr bool is_non_canonical_commutative(const CanonicalProgram &program,
+                                                          const CanonicalInstruction ins) noexcept
+{
+    const auto op = static_cast<Op>(ins.op);
+    if (not op_is_commutative(op) || ins.b < VARIABLE_COUNT) {
+        return false;
+    }
+    const CanonicalInstruction other = program[ins.b - VARIABLE_COUNT];
+    if (ins.op != other.op) {
+        return false;
+    }
+
+    const std::uint8_t a = ins.a;
+    const std::uint8_t b = other.a;
+    const std::uint8_t c = other.b;
+
+    // already in canonical order, nothing left to check
+    if (a < b) {
+        return false;
+    }
+
+    // if the instructions aren't equidistant,
+    // then requiring canonical ordering could also make valid programs impossible (possibly ?)
+    const std::uint8_t dist_a = distance_from_inputs(program, a);
+    const std::uint8_t dist_b = distance_from_inputs(program, b);
+    const std::uint8_t dist_c = distance_from_inputs(program, c);
+
+    return dist_a == dist_b && dist_a == dist_c;
+}
+
+template <bool Unary>
+[[nodiscard]] constexpr bool is_program_unrevivable(const CanonicalProgram &program,
+                                                    const unsigned a,
+                                                    const unsigned b) noexcept
+{
+    using state_type = CanonicalProgram::state_type;
+
+    const auto use = state_type{1} << a | state_type{not Unary} << b;
+
+    const std::size_t total_used = popcount(program.used_instructions() | use);
+    const std::size_t relevant = popcount(program.target_relevancy());
+    const std::size_t remaining = program.target_length() - program.size();
+
+    return relevant + program.size() + 1 > remaining + total_used;
+}
+
+/// the rules which can_push tests, in the order in which it tests them
+enum class PushRule : unsigned char {
+    /// no rule rejects the instruction
+    NONE,
+    CANONICAL_ORDER,
+    DOUBLE_NEGATION,
+    TRIVIAL_RESULT,
+    COMMUTATIVE_ORDER,
+    SUBOPTIMAL_AND_OR,
+    UNREVIVABLE,
+    DUPLICATE,
+};
+
+inline constexpr std::size_t PUSH_RULE_COUNT = 7;
+
+/// Returns true if the rule rejects pushing the instruction onto the program, which must not be empty.
+/// Every rule only depends on the program and the instruction, so the rules can be tested in any order.
+template <bool Unary>
+[[nodiscard]] constexpr bool rule_rejects(const PushRule rule,
+                                          const CanonicalProgram &program,
+                                          const CanonicalInstruction ins) noexcept
+{
+    switch (rule) {
+    case PushRule::NONE: return false;
+    case PushRule::CANONICAL_ORDER: return is_breaking_canonical_dag_order(program, ins);
+    case PushRule::DOUBLE_NEGATION: return is_double_negation(program, ins);
+    case PushRule::TRIVIAL_RESULT: return not Unary && are_complement_of_same_input(program, ins.a, ins.b);
+    case PushRule::COMMUTATIVE_ORDER: return not Unary && is_non_canonical_commutative(program, ins);
+    case PushRule::SUBOPTIMAL_AND_OR: return not Unary && is_suboptimal_and_or(program, ins);
+    case PushRule::UNREVIVABLE: return is_program_unrevivable<Unary>(program, ins.a, ins.b);
+    case PushRule::DUPLICATE: return contains(program, ins);
+    }
+    __builtin_unreachable();
+}
+
+/// Returns the first rule which rejects pushing the instruction, or PushRule::NONE if it can be pushed.
+template <bool Unary>
+[[nodiscard]] constexpr PushRule rejecting_rule(const CanonicalProgram &program,
+                                                const CanonicalInstruction ins) noexcept
+{
+    if (program.empty()) {
+        return PushRule::NONE;
+    }
+
+    // 1 prevent non-canonical ordering of instructions
+    if (is_breaking_canonical_dag_order(program, ins)) {
+        return PushRule::CANONICAL_ORDER;
+    }
+
+    // 2 prevent double negation
+    if (is_double_negation(program, ins)) {
+        return PushRule::DOUBLE_NEGATION;
+    }
+
+    // 3 prevent producing trivial results (x & !x => false, x | !x => true, x ^ !x => true, ...)
+    if (not Unary && are_complement_of_same_input(program, ins.a, ins.b)) {
+        return PushRule::TRIVIAL_RESULT;
+    }
+
+    // 4 non-canonical ordering of commutative operations, e.g. C and (A and B)
+    //   only A and (B and C) is allowed
+    if (not Unary && is_non_canonical_commutative(program, ins)) {
+        return PushRule::COMMUTATIVE_ORDER;
+    }
+
+    // 5 suboptimal use of and/or, e.g. A and SubExpr where A appears in SubExpr
+    if (not Unary && is_suboptimal_and_or(program, ins)) {
+        return PushRule::SUBOPTIMAL_AND_OR;
+    }
+
+    // 6 prevent creation of zombie programs
+    //   i.e. programs with so many dead (unused) instructions, that even after the addition of the given instruction,
+    //   not all subexpressions of the program can be used
+    if (is_program_unrevivable<Unary>(program, ins.a, ins.b)) {
+        return PushRule::UNREVIVABLE;
+    }
+
+    // 7 prevent duplicate evaluations
+    if (contains(program, ins)) {
+        return PushRule::DUPLICATE;
+    }
+
+    return PushRule::NONE;
+}
+
+template <bool Unary>
+[[nodiscard]] constexpr bool can_push(const CanonicalProgram &program, const CanonicalInstruction ins) noexcept
+{
+    return rejecting_rule<Unary>(program, ins) == PushRule::NONE;
+}
+
+/// Returns the instruction which computes op on the operands, with its distance from the inputs in the program.
+template <bool Unary>
+[[nodiscard]] constexpr CanonicalInstruction make_canonical_instruction(const CanonicalProgram &program,
+                                                                        const Op op,
+                                                                        const unsigned a,
+                                                                        const unsigned b) noexcept
+{
+    const auto base_dist = Unary ? distance_from_inputs(program, a)
+                                 : std::max(distance_from_inputs(program, a), distance_from_inputs(program, b));
+    const auto dist = static_cast<std::uint8_t>(base_dist + 1);
+
+    const auto op8 = static_cast<std::uint8_t>(op);
+    const auto a8 = static_cast<std::uint8_t>(a);
+    const auto b8 = static_cast<std::uint8_t>(b);
+    return {op8, a8, b8, dist};
+}
+
+template <bool Unary>
+[[nodiscard]] constexpr std::optional<CanonicalInstruction> can_push(const CanonicalProgram &program,
+                                                                     const Op op,
+                                                                     const unsigned a,
+                                                                     const unsigned b) noexcept
+{
+    const CanonicalInstruction ins = make_canonical_instruction<Unary>(program, op, a, b);
+    return can_push<Unary>(program, ins) ? std::optional{ins} : std::nullopt;
+}
+
+constexpr bool CanonicalProgram::try_push(const Op op, const unsigned a) noexcept
+{
+    if (auto ins = can_push<true>(*this, op, a, 0)) {
+        push(*ins);
+        return true;
+    }
+    return false;
+}
+
+constexpr bool CanonicalProgram::try_push(const Op op, const unsigned a, const unsigned b) noexcept
+{
+    if (auto ins = can_push<false>(*this, op, a, b)) {
+        push(*ins);
+        return true;
+    }
+    return false;
+}
+
+/// Returns the result of the program for one assignment of the inputs, given as the bits of the state.
+template <typename P>
+[[nodiscard]] constexpr bool program_emulate_once(const P &program, typename P::state_type state) noexcept
+{
+    bool res = false;
+    for (unsigned i = 0; i < program.size(); ++i) {
+        const auto &ins = program[i];
+        const bool a = get_bit(state, ins.a);
+        const bool b = get_bit(state, ins.b);
+        res = ins.op >> (a << 1 | b) & 1;
+        set_bit_if(state, i + 6, res);
+    }
+    return res;
+}
+
+/// whether program_emulate compares the results of a program to a table, or computes its table
+enum class TruthTableMode { TEST, FIND };
+
+template <TruthTableMode Mode, typename P, typename V>
+[[nodiscard]] constexpr std::uint64_t program_emulate(const P &program,
+                                                      const V variables,
+                                                      const TruthTable table [[maybe_unused]] = {}) noexcept
+{
+    std::uint64_t result = 0;
+    for (std::uint64_t v = 0; v < std::size_t{1} << variables; ++v) {
+        const bool res = program_emulate_once(program, v);
+        if constexpr (Mode == TruthTableMode::TEST) {
+            const bool expected = (res ? table.t : table.f) >> v & 1;
+            if (res != expected) {
+                return false;
+            }
+        }
+        else {
+            result |= std::uint64_t{res} << v;
+        }
+    }
+    return Mode == TruthTableMode::TEST ? 1u : result;
+}
+
+template <InstructionSet InstructionSet>
+[[nodiscard]] constexpr std::size_t instruction_set_size() noexcept
+{
+    std::size_t result = 0;
+    for (std::uint64_t opcode = to_underlying(InstructionSet); opcode != 0; opcode >>= 4) {
+        ++result;
+    }
+    return result;
+}
+
+/// Returns the operations of the instruction set in the order in which the search tries them.
+template <InstructionSet InstructionSet, SearchOrder Order>
+[[nodiscard]] constexpr std::array<Op, instruction_set_size<InstructionSet>()> instruction_set_ops() noexcept
+{
+    constexpr std::size_t size = instruction_set_size<InstructionSet>();
+    std::array<Op, size> result{};
+    std::uint64_t opcode = to_underlying(InstructionSet);
+    for (std::size_t i = 0; i < size; ++i, opcode >>= 4) {
+        result[Order == SearchOrder::FORWARD ? i : size - i - 1] = static_cast<Op>(opcode & 0xf);
+    }
+    return result;
+}
+
+/// Calls the visitor with every candidate instruction of a node in the order in which the search tries them: every
+/// operation of the instruction set, with every first operand, and every second operand which isn't ruled out by the
+/// commutativity of the operation. Unary operations get 0 as their second operand.
+/// The operands are numbered from 0 to operand_count - 1 and mapped to operand indices by fix_operand. The visitor
+/// takes std::true_type or std::false_type for unary and binary operations, followed by the operation and both
+/// operands, and returns true to stop, which is returned as well.
+/// This is the candidate loop of every depth first search, including the one used in constant evaluation.
+template <InstructionSet InstructionSet, SearchOrder Order, typename F, typename V>
+constexpr bool for_each_candidate(const unsigned operand_count, const F fix_operand, V &&visit) noexcept
+{
+    constexpr auto ops = instruction_set_ops<InstructionSet, Order>();
+    constexpr bool reverse = Order == SearchOrder::REVERSE;
+
+    for (const Op op : ops) {
+        const bool unary = op_is_unary(op);
+        const bool commutative = op_is_commutative(op);
+
+        for (unsigned i = 0; i < operand_count; ++i) {
+            const unsigned a = reverse ? operand_count - i - 1 : i;
+            const unsigned a_op = fix_operand(a);
+
+            if (unary) {
+                if (visit(std::true_type{}, op, a_op, 0u)) {
+                    return true;
+                }
+                continue;
+            }
+
+            const unsigned b_start = commutative * (a + 1);
+            for (unsigned j = b_start; j < operand_count; ++j) {
+                const unsigned b = reverse ? operand_count - j + b_start - 1 : j;
+                if (visit(std::false_type{}, op, a_op, fix_operand(b))) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
 #endif  // BRUTEFORCE_HPP
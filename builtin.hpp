@@ -18,35 +18,38 @@ namespace builtin {
 
 // int popcount(unsigned ...):
 //     Counts the number of one-bits in an unsigned integer type.
+//     BOOLEXPR_POPCOUNT_CONSTEXPR expands to constexpr if popcount can be used in constant expressions.
 #if defined(BOOLEXPR_GNU_OR_CLANG) && BOOLEXPR_HAS_BUILTIN(__builtin_popcount) && \
     BOOLEXPR_HAS_BUILTIN(__builtin_popcountl) && BOOLEXPR_HAS_BUILTIN(__builtin_popcountll)
 #define BOOLEXPR_HAS_BUILTIN_POPCOUNT
-inline int popcount(unsigned char x) noexcept
+#define BOOLEXPR_POPCOUNT_CONSTEXPR constexpr
+constexpr int popcount(unsigned char x) noexcept
 {
     return __builtin_popcount(x);
 }
 
-inline int popcount(unsigned short x) noexcept
+constexpr int popcount(unsigned short x) noexcept
 {
     return __builtin_popcount(x);
 }
 
-inline int popcount(unsigned int x) noexcept
+constexpr int popcount(unsigned int x) noexcept
 {
     return __builtin_popcount(x);
 }
 
-inline int popcount(unsigned long x) noexcept
+constexpr int popcount(unsigned long x) noexcept
 {
     return __builtin_popcountl(x);
 }
 
-inline int popcount(unsigned long long x) noexcept
+constexpr int popcount(unsigned long long x) noexcept
 {
     return __builtin_popcountll(x);
 }
 #elif defined(BOOLEXPR_MSVC)
 #define BOOLEXPR_HAS_BUILTIN_POPCOUNT
+#define BOOLEXPR_POPCOUNT_CONSTEXPR
 __forceinline int popcount(uint8_t x) noexcept
 {
     return static_cast<int>(__popcnt16(x));
@@ -0,0 +1,456 @@
+#include <array>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "codegen.hpp"
+
+namespace {
+
+/// the intrinsics of one SIMD extension, or none of them for the scalar code, which uses the built-in operators
+struct Dialect {
+    /// the suffix of the function name
+    const char *suffix;
+    /// the macro which the compiler defines if the extension is enabled, nullptr for the scalar code
+    const char *macro;
+    const char *type;
+    /// the number of std::uint64_t in one value
+    std::size_t lanes;
+    const char *load;
+    const char *store;
+    const char *and_op;
+    const char *or_op;
+    const char *xor_op;
+    /// computes ~x & y
+    const char *andnot_op;
+    const char *zero;
+    const char *ones;
+};
+
+// clang-format off
+constexpr Dialect SCALAR{"", nullptr, "std::uint64_t", 1, "", "", "", "", "", "", "std::uint64_t{0}",
+                         "~std::uint64_t{0}"};
+constexpr Dialect SSE2{"_sse2", "__SSE2__", "__m128i", 2, "_mm_loadu_si128", "_mm_storeu_si128", "_mm_and_si128",
+                       "_mm_or_si128", "_mm_xor_si128", "_mm_andnot_si128", "_mm_setzero_si128()",
+                       "_mm_set1_epi32(-1)"};
+constexpr Dialect AVX2{"_avx2", "__AVX2__", "__m256i", 4, "_mm256_loadu_si256", "_mm256_storeu_si256",
+                       "_mm256_and_si256", "_mm256_or_si256", "_mm256_xor_si256", "_mm256_andnot_si256",
+                       "_mm256_setzero_si256()", "_mm256_set1_epi32(-1)"};
+constexpr Dialect AVX512{"_avx512", "__AVX512F__", "__m512i", 8, "_mm512_loadu_si512", "_mm512_storeu_si512",
+                         "_mm512_and_si512", "_mm512_or_si512", "_mm512_xor_si512", "_mm512_andnot_si512",
+                         "_mm512_setzero_si512()", "_mm512_set1_epi32(-1)"};
+// clang-format on
+
+/// the dialects from the widest to the narrowest, which is the order in which the array function tries them
+constexpr const Dialect *DIALECTS[]{&AVX512, &AVX2, &SSE2, &SCALAR};
+
+/// the keywords and alternative tokens of C++, which cannot be names
+constexpr std::string_view CPP_KEYWORDS[]{
+    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch", "char",
+    "char8_t", "char16_t", "char32_t", "class", "compl", "concept", "const", "consteval", "constexpr", "constinit",
+    "const_cast", "continue", "co_await", "co_return", "co_yield", "decltype", "default", "delete", "do", "double",
+    "dynamic_cast", "else", "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if",
+    "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or",
+    "or_eq", "private", "protected", "public", "register", "reinterpret_cast", "requires", "return", "short", "signed",
+    "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw",
+    "true", "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+    "wchar_t", "while", "xor", "xor_eq",
+};
+
+[[nodiscard]] constexpr bool is_identifier_start(const char c) noexcept
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+[[nodiscard]] constexpr bool is_identifier_part(const char c) noexcept
+{
+    return is_identifier_start(c) || (c >= '0' && c <= '9') || c == '_';
+}
+
+/// a subexpression of at most three inputs, which AVX-512 evaluates with a single vpternlog
+struct Cone {
+    /// the operands which the cone reads, where the first is the most significant bit of a row of the table
+    std::array<unsigned, 3> leaves{};
+    unsigned size = 0;
+    /// the truth table of the cone, indexed like the immediate of vpternlog
+    std::uint8_t table = 0;
+
+    [[nodiscard]] static Cone leaf(const unsigned operand) noexcept
+    {
+        return {{operand, 0, 0}, 1, 0xf0};
+    }
+
+    /// Returns the result of the cone in a row of a table over other leaves, which must include those of the cone.
+    [[nodiscard]] bool at(const Cone &other, const unsigned row) const noexcept
+    {
+        unsigned own_row = 0;
+        for (unsigned k = 0; k < size; ++k) {
+            unsigned position = 0;
+            while (other.leaves[position] != leaves[k]) {
+                ++position;
+            }
+            own_row |= (row >> (2 - position) & 1) << (2 - k);
+        }
+        return table >> own_row & 1;
+    }
+};
+
+/// Returns the cone of an operation on two cones, or nothing if it would have more than three leaves.
+/// An operand which the operation ignores is given as an empty cone.
+[[nodiscard]] std::optional<Cone> combine(const Op op, const Cone &a, const Cone &b) noexcept
+{
+    Cone result = a;
+    for (unsigned k = 0; k < b.size; ++k) {
+        bool is_new = true;
+        for (unsigned l = 0; l < result.size; ++l) {
+            is_new &= result.leaves[l] != b.leaves[k];
+        }
+        if (is_new) {
+            if (result.size == result.leaves.size()) {
+                return std::nullopt;
+            }
+            result.leaves[result.size++] = b.leaves[k];
+        }
+    }
+    result.table = 0;
+    for (unsigned row = 0; row < 8; ++row) {
+        const unsigned op_row = unsigned{a.at(result, row)} << 1 | unsigned{b.at(result, row)};
+        result.table |= static_cast<std::uint8_t>((to_underlying(op) >> op_row & 1) << row);
+    }
+    return result;
+}
+
+class CppEmitter {
+private:
+    std::ostream &out;
+    const Program &program;
+    const std::string_view name;
+    const bool has_andn;
+    /// the names of the inputs, as parameters of the functions
+    std::array<std::string, VARIABLE_COUNT> inputs;
+    /// whether any instruction reads an input
+    std::array<bool, VARIABLE_COUNT> input_used{};
+    /// the number of instructions reading each instruction, plus one for the result
+    std::vector<unsigned> uses;
+    /// whether an instruction is NOT and folded into the AND which reads it
+    std::vector<bool> folded_not;
+    /// whether an instruction is merged into the cone of the instruction which reads it
+    std::vector<bool> is_merged;
+    std::vector<Cone> cones;
+
+public:
+    CppEmitter(std::ostream &out, const Program &program, const std::string_view name, const InstructionSet set)
+        : out{out}
+        , program{program}
+        , name{name}
+        , has_andn{instruction_set_contains(set, Op::A_ANDN_B)}
+        , uses(program.size())
+        , folded_not(program.size())
+        , is_merged(program.size())
+        , cones(program.size())
+    {
+    }
+
+    void emit()
+    {
+        name_inputs();
+        count_uses();
+        fold_nots();
+        merge_cones();
+
+        std::string expression;
+        append_program_as_expression(expression, program);
+        out << "// " << name << " = " << expression;
+        out << "#pragma once\n\n"
+               "#include <cstddef>\n"
+               "#include <cstdint>\n\n"
+               "#if defined(__SSE2__) || defined(__AVX2__) || defined(__AVX512F__)\n"
+               "#include <immintrin.h>\n"
+               "#endif\n\n";
+
+        emit_function(SCALAR);
+        out << '\n';
+        for (const Dialect *dialect : {&SSE2, &AVX2, &AVX512}) {
+            out << "#ifdef " << dialect->macro << '\n';
+            emit_function(*dialect);
+            out << "#endif\n\n";
+        }
+        emit_array_function();
+    }
+
+private:
+    void name_inputs()
+    {
+        for (std::size_t i = 0; i < program.variables; ++i) {
+            std::string symbol = program.symbol(i, false);
+            // every other name in the generated code begins with an underscore, which no identifier symbol does
+            inputs[i] = is_cpp_identifier(symbol) ? std::move(symbol) : "_x" + std::to_string(i);
+        }
+    }
+
+    void count_uses() noexcept
+    {
+        const auto use = [this](const unsigned operand) {
+            if (operand < VARIABLE_COUNT) {
+                input_used[operand] = true;
+            }
+            else {
+                ++uses[operand - VARIABLE_COUNT];
+            }
+        };
+        for (std::size_t i = 0; i < program.size(); ++i) {
+            const Op op = static_cast<Op>(program[i].op);
+            if (op_uses_a(op)) {
+                use(program[i].a);
+            }
+            if (op_uses_b(op)) {
+                use(program[i].b);
+            }
+        }
+        if (not program.empty()) {
+            ++uses.back();
+        }
+    }
+
+    [[nodiscard]] bool is_single_use(const unsigned operand) const noexcept
+    {
+        return operand >= VARIABLE_COUNT && uses[operand - VARIABLE_COUNT] == 1;
+    }
+
+    [[nodiscard]] bool is_foldable_not(const unsigned operand) const noexcept
+    {
+        return is_single_use(operand) && static_cast<Op>(program[operand - VARIABLE_COUNT].op) == Op::NOT_A;
+    }
+
+    /// Folds NOT into the AND which reads it, preferring the second operand, like expression does.
+    void fold_nots() noexcept
+    {
+        if (not has_andn) {
+            return;
+        }
+        for (std::size_t i = 0; i < program.size(); ++i) {
+            const Instruction ins = program[i];
+            if (static_cast<Op>(ins.op) != Op::AND) {
+                continue;
+            }
+            if (is_foldable_not(ins.b)) {
+                folded_not[ins.b - VARIABLE_COUNT] = true;
+            }
+            else if (is_foldable_not(ins.a)) {
+                folded_not[ins.a - VARIABLE_COUNT] = true;
+            }
+        }
+    }
+
+    /// Builds the cone of every instruction, merging the cones of operands with a single use where the result still
+    /// has at most three leaves.
+    void merge_cones()
+    {
+        for (std::size_t i = 0; i < program.size(); ++i) {
+            const Instruction ins = program[i];
+            const Op op = static_cast<Op>(ins.op);
+            const bool merge_a = op_uses_a(op) && is_single_use(ins.a);
+            const bool merge_b = op_uses_b(op) && is_single_use(ins.b);
+
+            const auto cone_of = [&](const bool used, const bool merge, const unsigned operand) {
+                return not used ? Cone{} : merge ? cones[operand - VARIABLE_COUNT] : Cone::leaf(operand);
+            };
+            constexpr std::pair<bool, bool> attempts[]{{true, true}, {true, false}, {false, true}, {false, false}};
+            for (const auto &[try_a, try_b] : attempts) {
+                if ((try_a && not merge_a) || (try_b && not merge_b)) {
+                    continue;
+                }
+                const Cone a = cone_of(op_uses_a(op), try_a, ins.a);
+                const Cone b = cone_of(op_uses_b(op), try_b, ins.b);
+                if (const std::optional<Cone> cone = combine(op, a, b)) {
+                    cones[i] = *cone;
+                    if (try_a) {
+                        is_merged[ins.a - VARIABLE_COUNT] = true;
+                    }
+                    if (try_b) {
+                        is_merged[ins.b - VARIABLE_COUNT] = true;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] std::string operand(const unsigned o) const
+    {
+        return o < VARIABLE_COUNT ? inputs[o] : "_t" + std::to_string(o - VARIABLE_COUNT);
+    }
+
+    [[nodiscard]] static std::string call(const char *function, const std::string &x, const std::string &y)
+    {
+        return std::string{function} + '(' + x + ", " + y + ')';
+    }
+
+    [[nodiscard]] static std::string
+    binary(const Dialect &d, const Op op, const std::string &x, const std::string &y)
+    {
+        if (d.macro == nullptr) {
+            const char *symbol = op == Op::AND ? " & " : op == Op::OR ? " | " : " ^ ";
+            return '(' + x + symbol + y + ')';
+        }
+        return call(op == Op::AND ? d.and_op : op == Op::OR ? d.or_op : d.xor_op, x, y);
+    }
+
+    [[nodiscard]] static std::string complement(const Dialect &d, const std::string &x)
+    {
+        return d.macro == nullptr ? '~' + x : call(d.xor_op, x, d.ones);
+    }
+
+    /// Returns ~x & y.
+    [[nodiscard]] static std::string andnot(const Dialect &d, const std::string &x, const std::string &y)
+    {
+        return d.macro == nullptr ? "(~" + x + " & " + y + ')' : call(d.andnot_op, x, y);
+    }
+
+    [[nodiscard]] std::string expression(const Dialect &d, const Instruction ins) const
+    {
+        const Op op = static_cast<Op>(ins.op);
+        const std::string a = operand(ins.a);
+        const std::string b = operand(ins.b);
+
+        if (op == Op::AND && has_andn) {
+            if (is_folded_not(ins.b)) {
+                return andnot(d, operand(program[ins.b - VARIABLE_COUNT].a), a);
+            }
+            if (is_folded_not(ins.a)) {
+                return andnot(d, operand(program[ins.a - VARIABLE_COUNT].a), b);
+            }
+        }
+        switch (op) {
+        case Op::FALSE: return d.zero;
+        case Op::NOR: return complement(d, binary(d, Op::OR, a, b));
+        case Op::B_ANDN_A: return andnot(d, a, b);
+        case Op::NOT_A: return complement(d, a);
+        case Op::A_ANDN_B: return andnot(d, b, a);
+        case Op::NOT_B: return complement(d, b);
+        case Op::XOR: return binary(d, Op::XOR, a, b);
+        case Op::NAND: return complement(d, binary(d, Op::AND, a, b));
+        case Op::AND: return binary(d, Op::AND, a, b);
+        case Op::NXOR: return complement(d, binary(d, Op::XOR, a, b));
+        case Op::B: return b;
+        case Op::A_CONS_B: return complement(d, andnot(d, b, a));
+        case Op::A: return a;
+        case Op::B_CONS_A: return complement(d, andnot(d, a, b));
+        case Op::OR: return binary(d, Op::OR, a, b);
+        case Op::TRUE: return d.ones;
+        }
+        __builtin_unreachable();
+    }
+
+    [[nodiscard]] bool is_folded_not(const unsigned operand) const noexcept
+    {
+        return operand >= VARIABLE_COUNT && folded_not[operand - VARIABLE_COUNT];
+    }
+
+    [[nodiscard]] std::string ternary_expression(const Cone &cone) const
+    {
+        if (cone.size == 0) {
+            return cone.table & 1 ? AVX512.ones : AVX512.zero;
+        }
+        if (cone.size == 1 && cone.table == 0xf0) {
+            return operand(cone.leaves[0]);
+        }
+        std::string result = "_mm512_ternarylogic_epi64(";
+        for (unsigned k = 0; k < 3; ++k) {
+            result += operand(cone.leaves[k < cone.size ? k : 0]);
+            result += ", ";
+        }
+        constexpr char hex_digits[] = "0123456789abcdef";
+        result += "0x";
+        result += hex_digits[cone.table >> 4];
+        result += hex_digits[cone.table & 0xf];
+        result += ')';
+        return result;
+    }
+
+    void emit_parameters(const char *type, const char *declarator, const bool mark_unused)
+    {
+        for (std::size_t i = 0; i < program.variables; ++i) {
+            out << (i == 0 ? "" : ", ") << (mark_unused && not input_used[i] ? "[[maybe_unused]] " : "") << "const "
+                << type << declarator << inputs[i];
+        }
+    }
+
+    void emit_function(const Dialect &d)
+    {
+        out << "inline " << d.type << ' ' << name << d.suffix << '(';
+        emit_parameters(d.type, " ", true);
+        out << ") noexcept\n{\n";
+
+        for (std::size_t i = 0; i < program.size(); ++i) {
+            const bool is_skipped = &d == &AVX512 ? is_merged[i] : folded_not[i];
+            if (is_skipped) {
+                continue;
+            }
+            const std::string value = &d == &AVX512 ? ternary_expression(cones[i]) : expression(d, program[i]);
+            out << "    const " << d.type << ' ' << operand(static_cast<unsigned>(i + VARIABLE_COUNT)) << " = "
+                << value << ";\n";
+        }
+        const std::string result =
+            program.empty() ? d.zero : operand(static_cast<unsigned>(program.size() - 1 + VARIABLE_COUNT));
+        out << "    return " << result << ";\n}\n";
+    }
+
+    void emit_array_function()
+    {
+        out << "/// Computes _out[i] = " << name << "(...[i]) for every i < _n.\n";
+        out << "inline void " << name << "_array(const std::size_t _n, ";
+        emit_parameters("std::uint64_t", " *const ", false);
+        out << (program.variables == 0 ? "" : ", ") << "std::uint64_t *const _out) noexcept\n{\n";
+        out << "    std::size_t _i = 0;\n";
+
+        for (const Dialect *d : DIALECTS) {
+            if (d->macro != nullptr) {
+                out << "#ifdef " << d->macro << '\n';
+                out << "    for (; _i + " << d->lanes << " <= _n; _i += " << d->lanes << ") {\n";
+                out << "        " << d->store << "(reinterpret_cast<" << d->type << " *>(_out + _i), " << name
+                    << d->suffix << '(';
+                for (std::size_t i = 0; i < program.variables; ++i) {
+                    out << (i == 0 ? "" : ", ") << d->load << "(reinterpret_cast<const " << d->type << " *>("
+                        << inputs[i] << " + _i))";
+                }
+                out << "));\n    }\n#endif\n";
+                continue;
+            }
+            out << "    for (; _i < _n; ++_i) {\n";
+            out << "        _out[_i] = " << name << '(';
+            for (std::size_t i = 0; i < program.variables; ++i) {
+                out << (i == 0 ? "" : ", ") << inputs[i] << "[_i]";
+            }
+            out << ");\n    }\n";
+        }
+        out << "}\n";
+    }
+};
+
+}  // namespace
+
+bool is_cpp_identifier(const std::string_view str) noexcept
+{
+    if (str.empty() || not is_identifier_start(str.front())) {
+        return false;
+    }
+    for (const char c : str) {
+        if (not is_identifier_part(c)) {
+            return false;
+        }
+    }
+    for (const std::string_view keyword : CPP_KEYWORDS) {
+        if (str == keyword) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void emit_cpp(std::ostream &out, const Program &program, const std::string_view name, const InstructionSet set)
+{
+    CppEmitter{out, program, name, set}.emit();
+}
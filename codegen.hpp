@@ -0,0 +1,29 @@
+#ifndef CODEGEN_HPP
+#define CODEGEN_HPP
+
+#include <iosfwd>
+#include <string_view>
+
+#include "program.hpp"
+
+/// Returns true if the string can be used as a name in C++, i.e. it is an identifier which is not a keyword and
+/// does not begin with an underscore.
+[[nodiscard]] bool is_cpp_identifier(std::string_view str) noexcept;
+
+/// Writes a self-contained C++ header of branch-free functions which evaluate the program on every bit of their
+/// inputs at once:
+///
+///  - NAME takes and returns std::uint64_t
+///  - NAME_sse2, NAME_avx2 and NAME_avx512 take and return __m128i, __m256i and __m512i, each only defined if the
+///    including translation unit is compiled for the corresponding instruction set
+///  - NAME_array applies the program to arrays of n words, using the widest of the above which is available
+///
+/// NOT is folded into AND as andnot if the instruction set contains Op::A_ANDN_B. The AVX-512 variant merges chains
+/// of single-use instructions with at most three inputs into one vpternlog each.
+/// Inputs are named after the symbols of the program where these are C++ identifiers.
+void emit_cpp(std::ostream &out,
+              const Program &program,
+              std::string_view name,
+              InstructionSet instruction_set = InstructionSet::X64);
+
+#endif  // CODEGEN_HPP
@@ -1,10 +1,12 @@
 #include "compiler.hpp"
+#include "trace.hpp"
 
 #include <algorithm>
-#include <iostream>
-#include <queue>
-
-constexpr unsigned VARIABLE_LIMIT = 6;
+#include <string>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <unordered_map>
 
 namespace {
 
@@ -23,72 +25,102 @@ struct ParserToken {
     return order == SymbolOrder::APPEARANCE_DESCENDING || order == SymbolOrder::LEX_DESCENDING;
 }
 
-unsigned find_symbols(std::string *const symbols, const std::vector<Token> &tokens)
-{
-    unsigned symbol_count = 0;
+/// A stack in storage owned by a ParserArena, with room for as many entries as the expression has tokens.
+template <typename T>
+class ArenaStack {
+private:
+    T *items;
+    std::size_t count = 0;
 
-    for (const auto &token : tokens) {
-        if (token.type != TokenType::LITERAL) {
-            continue;
-        }
+public:
+    explicit ArenaStack(T *items) noexcept : items{items} {}
 
-        const auto pos = std::find(symbols, symbols + VARIABLE_LIMIT, token.value);
-        if (pos != symbols + VARIABLE_LIMIT) {
-            continue;
-        }
-        if (symbol_count == 6) {
-            std::cout << "Too many variables! (at most " << VARIABLE_LIMIT << " allowed)\n";
-            std::exit(1);
-        }
-        symbols[symbol_count++] = token.value;
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return count == 0;
     }
 
-    return symbol_count;
-}
+    [[nodiscard]] T &back() noexcept
+    {
+        return items[count - 1];
+    }
 
-void sort_symbol_table(std::string *const symbols, const unsigned count, const SymbolOrder order) noexcept
-{
-    if (order_is_lexicographical(order)) {
-        std::sort(symbols, symbols + count);
+    void push_back(const T &item) noexcept
+    {
+        items[count++] = item;
     }
-    if (order_is_descending(order)) {
-        std::reverse(symbols, symbols + count);
+
+    void pop_back() noexcept
+    {
+        --count;
     }
-}
 
-void apply_symbol_table(const std::string *const symbols,
-                        const unsigned count,
-                        std::vector<ParserToken> &parserTokens,
-                        const std::vector<Token> &tokens)
-{
-    parserTokens.reserve(tokens.size());
+    void clear() noexcept
+    {
+        count = 0;
+    }
 
-    for (const auto &token : tokens) {
-        if (token.type != TokenType::LITERAL) {
-            parserTokens.push_back({token.type, 0});
-            continue;
-        }
+    [[nodiscard]] const T *begin() const noexcept
+    {
+        return items;
+    }
 
-        const auto pos = std::find(symbols, symbols + count, token.value);
-        const auto index = static_cast<unsigned>(pos - symbols);
-        parserTokens.push_back({token.type, index});
+    [[nodiscard]] const T *end() const noexcept
+    {
+        return items + count;
     }
-}
+};
 
-unsigned init_symbol_table(std::string *const symbols,
-                           std::vector<ParserToken> &parserTokens,
-                           const std::vector<Token> &tokens,
-                           const SymbolOrder order)
+/// A single allocation for all token sequences and stacks of the parser,
+/// none of which can ever hold more entries than the expression has tokens.
+class ParserArena {
+private:
+    static constexpr std::size_t REGIONS = 3;
+
+    std::size_t capacity;
+    std::unique_ptr<ParserToken[]> storage;
+
+public:
+    explicit ParserArena(const std::size_t tokens) : capacity{tokens}, storage{new ParserToken[REGIONS * tokens]} {}
+
+    [[nodiscard]] ArenaStack<ParserToken> region(const std::size_t i) noexcept
+    {
+        return ArenaStack<ParserToken>{storage.get() + i * capacity};
+    }
+};
+
+[[nodiscard]] std::optional<Error> init_symbol_table(Netlist &netlist,
+                                                    ArenaStack<ParserToken> &parser_tokens,
+                                                    const TokenList &tokens,
+                                                    const SymbolOrder order)
 {
-    const unsigned count = find_symbols(symbols, tokens);
+    const auto count = static_cast<std::uint32_t>(tokens.symbols.size());
     if (count == 0) {
-        std::cout << "Expression does not contain any variables\n";
-        std::exit(1);
+        return Error{ErrorCode::NO_VARIABLES, "Expression does not contain any variables"};
     }
 
-    sort_symbol_table(symbols, count, order);
-    apply_symbol_table(symbols, count, parserTokens, tokens);
-    return count;
+    // symbol ids are in order of appearance
+    std::vector<std::uint32_t> ids(count);
+    std::iota(ids.begin(), ids.end(), 0);
+    if (order_is_lexicographical(order)) {
+        std::sort(ids.begin(), ids.end(), [&tokens](const std::uint32_t x, const std::uint32_t y) {
+            return tokens.symbols[x] < tokens.symbols[y];
+        });
+    }
+    if (order_is_descending(order)) {
+        std::reverse(ids.begin(), ids.end());
+    }
+
+    std::vector<std::uint32_t> operands(count);
+    netlist.inputs = count;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        operands[ids[i]] = i;
+        netlist.input_names.push(tokens.symbols[ids[i]]);
+    }
+    for (const Token &token : tokens.tokens) {
+        parser_tokens.push_back({token.type, token.type == TokenType::LITERAL ? operands[token.symbol] : 0});
+    }
+    return std::nullopt;
 }
 
 constexpr unsigned token_precedence(const TokenType type) noexcept
@@ -132,11 +164,14 @@ constexpr Op token_operation(const TokenType type) noexcept
     __builtin_unreachable();
 }
 
-template <typename T>
-bool to_reverse_polish_notation_impl(std::vector<T> &output, const std::vector<T> &tokens)
+[[nodiscard]] Error syntax_error(const char *const message)
 {
-    std::vector<T> op_stack;
+    return Error{ErrorCode::SYNTAX_ERROR, message};
+}
 
+template <typename Output, typename Stack, typename Input>
+[[nodiscard]] std::optional<Error> to_reverse_polish_notation_impl(Output &output, Stack &op_stack, const Input &tokens)
+{
     const auto pop_stack_push_output = [&output, &op_stack] {
         output.push_back(std::move(op_stack.back()));
         op_stack.pop_back();
@@ -151,19 +186,14 @@ bool to_reverse_polish_notation_impl(std::vector<T> &output, const std::vector<T
         case TokenType::PARENS_OPEN: op_stack.push_back(token); break;
 
         case TokenType::PARENS_CLOSE:
-            while (op_stack.back().type != TokenType::PARENS_OPEN) {
-                if (op_stack.empty()) {
-                    std::cout << "Syntax error: mismatched parentheses\n";
-                    return false;
-                }
+            while (not op_stack.empty() && op_stack.back().type != TokenType::PARENS_OPEN) {
                 pop_stack_push_output();
             }
-            if (op_stack.back().type != TokenType::PARENS_OPEN) {
-                std::cout << "Syntax error: mismatched parentheses\n";
-                return false;
+            if (op_stack.empty()) {
+                return syntax_error("Syntax error: mismatched parentheses");
             }
             op_stack.pop_back();  // discard opening parenthesis
-            if (op_stack.back().type == TokenType::NOT) {
+            if (not op_stack.empty() && op_stack.back().type == TokenType::NOT) {
                 pop_stack_push_output();
             }
             break;
@@ -179,64 +209,238 @@ bool to_reverse_polish_notation_impl(std::vector<T> &output, const std::vector<T
 
     while (not op_stack.empty()) {
         if (op_stack.back().type == TokenType::PARENS_OPEN) {
-            std::cout << "Syntax error: mismatched parentheses\n";
-            return false;
+            return syntax_error("Syntax error: mismatched parentheses");
         }
         pop_stack_push_output();
     }
-    return true;
+    return std::nullopt;
+}
+
+/// Returns the operation which computes op(value, b), so that it no longer depends on its first operand.
+[[nodiscard]] constexpr Op op_fix_a(const Op op, const bool value) noexcept
+{
+    const unsigned rows = static_cast<unsigned>(op) >> (value ? 2 : 0) & 0b11u;
+    return static_cast<Op>(rows | rows << 2);
+}
+
+/// Returns the operation which computes op(a, value), so that it no longer depends on its second operand.
+[[nodiscard]] constexpr Op op_fix_b(const Op op, const bool value) noexcept
+{
+    const unsigned bits = static_cast<unsigned>(op) >> (value ? 1 : 0) & 0b0101u;
+    return static_cast<Op>(bits | bits << 1);
 }
 
-bool compile_from_polish(Program &p, const std::vector<ParserToken> &polish_tokens) noexcept
+/// Returns the operation which computes op(a, a).
+[[nodiscard]] constexpr Op op_same_operands(const Op op) noexcept
 {
-    std::vector<std::uint8_t> stack;
+    const unsigned bits = static_cast<unsigned>(op);
+    return static_cast<Op>((bits & 1u) * 0b0011u | (bits >> 3 & 1u) * 0b1100u);
+}
+
+/// Returns the operation which computes op(~a, b).
+[[nodiscard]] constexpr Op op_invert_a(const Op op) noexcept
+{
+    const unsigned bits = static_cast<unsigned>(op);
+    return static_cast<Op>((bits & 0b0011u) << 2 | (bits & 0b1100u) >> 2);
+}
+
+/// Returns the operation which computes op(a, ~b).
+[[nodiscard]] constexpr Op op_invert_b(const Op op) noexcept
+{
+    const unsigned bits = static_cast<unsigned>(op);
+    return static_cast<Op>((bits & 0b0101u) << 1 | (bits & 0b1010u) >> 1);
+}
+
+static_assert(op_fix_a(Op::AND, true) == Op::B && op_fix_a(Op::AND, false) == Op::FALSE);
+static_assert(op_fix_b(Op::A_ANDN_B, false) == Op::A && op_fix_b(Op::OR, true) == Op::TRUE);
+static_assert(op_same_operands(Op::XOR) == Op::FALSE && op_same_operands(Op::NAND) == Op::NOT_A);
+static_assert(op_invert_a(Op::AND) == Op::B_ANDN_A && op_invert_b(Op::AND) == Op::A_ANDN_B);
+
+/// Builds a netlist while hash-consing its gates and folding constants, negations and trivial identities,
+/// so that equal subexpressions are only computed once.
+class FoldingBuilder {
+public:
+    /// operands which stand for constants and never appear in the built netlist
+    static constexpr std::uint32_t FALSE_OPERAND = ~std::uint32_t{1};
+    static constexpr std::uint32_t TRUE_OPERAND = ~std::uint32_t{0};
+
+private:
+    Netlist &netlist;
+    /// the gate of each pair of operands, separately for each operation
+    std::unordered_map<std::uint64_t, std::uint32_t> gates[16];
+
+public:
+    explicit FoldingBuilder(Netlist &netlist) noexcept : netlist{netlist} {}
+
+    std::uint32_t push(Op op, std::uint32_t a, std::uint32_t b)
+    {
+        if (op_is_unary(op)) {
+            b = a;
+        }
+        if (is_constant(a)) {
+            op = op_fix_a(op, a == TRUE_OPERAND);
+            a = b;
+        }
+        if (is_constant(b)) {
+            op = op_fix_b(op, b == TRUE_OPERAND);
+            b = a;
+        }
+        // absorb negated operands into the operation, which also cancels double negations
+        while (const std::optional<std::uint32_t> negated = negated_operand(a)) {
+            op = a == b ? op_invert_b(op_invert_a(op)) : op_invert_a(op);
+            b = a == b ? *negated : b;
+            a = *negated;
+        }
+        while (const std::optional<std::uint32_t> negated = negated_operand(b)) {
+            op = op_invert_b(op);
+            b = *negated;
+        }
+        if (a == b) {
+            op = op_same_operands(op);
+        }
+        if (not op_uses_a(op)) {
+            op = op_transpose(op);
+            std::swap(a, b);
+        }
+
+        if (not op_uses_a(op)) {
+            return op == Op::TRUE ? TRUE_OPERAND : FALSE_OPERAND;
+        }
+        if (op == Op::A) {
+            return a;
+        }
+        if (not op_uses_b(op)) {
+            b = 0;
+        }
+        else if (b < a) {
+            op = op_transpose(op);
+            std::swap(a, b);
+        }
+
+        const auto [it, inserted] =
+            gates[to_underlying(op)].try_emplace(std::uint64_t{a} << 32 | b, netlist.operand_count());
+        if (inserted) {
+            netlist.push(op, a, b);
+        }
+        return it->second;
+    }
+
+    /// Makes the result the only output and removes everything else.
+    void finish(std::uint32_t result)
+    {
+        if (is_constant(result)) {
+            result = netlist.push(result == TRUE_OPERAND ? Op::TRUE : Op::FALSE, 0, 0);
+        }
+        netlist.outputs = {result};
+        netlist = remove_dead_gates(netlist);
+    }
+
+private:
+    [[nodiscard]] static constexpr bool is_constant(const std::uint32_t operand) noexcept
+    {
+        return operand >= FALSE_OPERAND;
+    }
+
+    /// Returns x if the operand is the result of NOT x.
+    [[nodiscard]] std::optional<std::uint32_t> negated_operand(const std::uint32_t operand) const noexcept
+    {
+        if (netlist.is_input(operand) || is_constant(operand)) {
+            return std::nullopt;
+        }
+        const Gate gate = netlist.gate(operand);
+        if (static_cast<Op>(gate.op) != Op::NOT_A) {
+            return std::nullopt;
+        }
+        return gate.a;
+    }
+};
+
+[[nodiscard]] std::optional<Error> compile_from_polish(Netlist &netlist,
+                                                      const ArenaStack<ParserToken> &polish_tokens,
+                                                      ArenaStack<ParserToken> &stack)
+{
+    FoldingBuilder builder{netlist};
+    stack.clear();
     for (const auto token : polish_tokens) {
         if (token.type == TokenType::LITERAL) {
-            stack.push_back(static_cast<std::uint8_t>(token.operand));
+            stack.push_back(token);
             continue;
         }
         Op op = token_operation(token.type);
         if (op_is_trivial(op)) {
-            std::cout << "Internal error";
-            return false;
+            return Error{ErrorCode::INTERNAL, "Internal error"};
+        }
+        if (stack.empty()) {
+            return syntax_error("Syntax error: missing operand");
         }
-        const auto next_operand = static_cast<std::uint8_t>(p.size() + VARIABLE_LIMIT);
         if (op_is_unary(op)) {
-            auto top_op = std::exchange(stack.back(), next_operand);
-            p.push({static_cast<std::uint8_t>(op), top_op, 0});
+            stack.back().operand = builder.push(op, stack.back().operand, 0);
         }
         else {
-            auto top_b = stack.back();
+            const unsigned top_b = stack.back().operand;
             stack.pop_back();
-            auto top_a = std::exchange(stack.back(), next_operand);
-            p.push({static_cast<std::uint8_t>(op), top_a, top_b});
+            if (stack.empty()) {
+                return syntax_error("Syntax error: missing operand");
+            }
+            stack.back().operand = builder.push(op, stack.back().operand, top_b);
         }
     }
-    return true;
-}
-
-bool do_compile(Program &program, const std::vector<ParserToken> &tokens)
-{
-    std::vector<ParserToken> reverse_polish;
-    if (not to_reverse_polish_notation_impl(reverse_polish, tokens)) {
-        return false;
+    const unsigned result = stack.back().operand;
+    stack.pop_back();
+    if (not stack.empty()) {
+        return syntax_error("Syntax error: missing operator");
     }
-    return compile_from_polish(program, reverse_polish);
+    builder.finish(result);
+    return std::nullopt;
 }
 
 }  // namespace
 
-bool to_reverse_polish_notation(std::vector<Token> &output, const std::vector<Token> &tokens)
+Result<std::vector<Token>> to_reverse_polish_notation(const std::vector<Token> &tokens)
 {
-    return to_reverse_polish_notation_impl(output, tokens);
+    std::vector<Token> output;
+    std::vector<Token> op_stack;
+    if (std::optional<Error> error = to_reverse_polish_notation_impl(output, op_stack, tokens)) {
+        return std::move(*error);
+    }
+    return output;
 }
 
-Program compile(const std::vector<Token> &tokens, const SymbolOrder order) noexcept
+Result<Netlist> compile_netlist(const TokenList &tokens, const SymbolOrder order)
 {
-    Program p{};
-    std::vector<ParserToken> parser_tokens;
-    p.variables = init_symbol_table(p.symbols.data(), parser_tokens, tokens, order);
+    const TraceScope trace{"compile", "tokens", tokens.tokens.size()};
+    Netlist netlist;
+    ParserArena arena{tokens.tokens.size()};
+    ArenaStack<ParserToken> parser_tokens = arena.region(0);
+    ArenaStack<ParserToken> reverse_polish = arena.region(1);
+    ArenaStack<ParserToken> stack = arena.region(2);
+
+    std::optional<Error> error = init_symbol_table(netlist, parser_tokens, tokens, order);
+    if (not error.has_value()) {
+        error = to_reverse_polish_notation_impl(reverse_polish, stack, parser_tokens);
+    }
+    if (not error.has_value()) {
+        error = compile_from_polish(netlist, reverse_polish, stack);
+    }
+    if (error.has_value()) {
+        return std::move(*error);
+    }
+    return netlist;
+}
 
-    do_compile(p, parser_tokens);
-    return p;
+Result<Program> compile(const TokenList &tokens, const SymbolOrder order)
+{
+    Result<Netlist> netlist = compile_netlist(tokens, order);
+    if (not netlist.has_value()) {
+        return netlist.error();
+    }
+    std::optional<Program> program = program_from_netlist(*netlist);
+    if (not program.has_value()) {
+        return Error{ErrorCode::TOO_LARGE,
+                     "Expression has " + std::to_string(netlist->inputs) + " variables and " +
+                         std::to_string(netlist->gate_count()) + " instructions, but programs are limited to " +
+                         std::to_string(VARIABLE_COUNT) + " variables and " +
+                         std::to_string(Program::instruction_count) + " instructions"};
+    }
+    return std::move(*program);
 }
@@ -2,11 +2,20 @@
 #define COMPILER_HPP
 
 #include "lexer.hpp"
+#include "netlist.hpp"
+#include "result.hpp"
 
 enum class SymbolOrder { APPEARANCE_ASCENDING, APPEARANCE_DESCENDING, LEX_ASCENDING, LEX_DESCENDING };
 
-[[nodiscard]] bool to_reverse_polish_notation(std::vector<Token> &output, const std::vector<Token> &tokens);
+[[nodiscard]] Result<std::vector<Token>> to_reverse_polish_notation(const std::vector<Token> &tokens);
 
-[[nodiscard]] Program compile(const std::vector<Token> &tokens, SymbolOrder order) noexcept;
+/// Compiles an expression with any number of variables into a netlist with a single output.
+/// The gates may use any of the sixteen operations, not only those of the expression: negations are folded into the
+/// operations which use them, so that e.g. "a and not b" becomes a single Op::A_ANDN_B gate.
+[[nodiscard]] Result<Netlist> compile_netlist(const TokenList &tokens, SymbolOrder order);
+
+/// Compiles an expression into a program, which only works for programs of at most six variables.
+/// The operations are those of compile_netlist, so Program::uses_only tells whether a search could find the program.
+[[nodiscard]] Result<Program> compile(const TokenList &tokens, SymbolOrder order);
 
 #endif
@@ -8,16 +8,60 @@ constexpr auto HELP_SHORT = 'h';
 constexpr auto HELP_LONG = "--help";
 constexpr auto EXPR_SHORT = 'e';
 constexpr auto EXPR_LONG = "--expr";
+constexpr auto EXPR_FILE_SHORT = 'f';
+constexpr auto EXPR_FILE_LONG = "--expr-file";
 constexpr auto TABLE_SHORT = 't';
 constexpr auto TABLE_LONG = "--table";
+constexpr auto INPUT_NETLIST_SHORT = 'i';
+constexpr auto INPUT_NETLIST_LONG = "--input";
+constexpr auto OUTPUT_NETLIST_SHORT = 'o';
+constexpr auto OUTPUT_NETLIST_LONG = "--output";
+constexpr auto EMIT_SHORT = 'E';
+constexpr auto EMIT_LONG = "--emit";
 constexpr auto SYMBOL_ORDER_SHORT = 's';
 constexpr auto SYMBOL_ORDER_LONG = "--symbol-order";
 constexpr auto GREEDY_SHORT = 'g';
 constexpr auto GREEDY_LONG = "--greedy";
+constexpr auto FIRST_SHORT = 'n';
+constexpr auto FIRST_LONG = "--first";
 constexpr auto OUTPUT_EXPR_SHORT = 'x';
 constexpr auto OUTPUT_EXPR_LONG = "--print-expr";
 constexpr auto OUTPUT_PROGRAM_SHORT = 'p';
 constexpr auto OUTPUT_PROGRAM_LONG = "--print-program";
+constexpr auto OUTPUT_BINARY_SHORT = 'b';
+constexpr auto OUTPUT_BINARY_LONG = "--print-binary";
+constexpr auto COUNT_SHORT = 'c';
+constexpr auto COUNT_LONG = "--count";
+constexpr auto UNIQUE_SHORT = 'u';
+constexpr auto UNIQUE_LONG = "--unique";
+constexpr auto PORTFOLIO_SHORT = 'R';
+constexpr auto PORTFOLIO_LONG = "--portfolio";
+constexpr auto HEURISTIC_SHORT = 'H';
+constexpr auto HEURISTIC_LONG = "--heuristic";
+constexpr auto ANYTIME_SHORT = 'A';
+constexpr auto ANYTIME_LONG = "--anytime";
+constexpr auto TIMEOUT_SHORT = 'T';
+constexpr auto TIMEOUT_LONG = "--timeout";
+constexpr auto NODE_BUDGET_SHORT = 'N';
+constexpr auto NODE_BUDGET_LONG = "--node-budget";
+constexpr auto STATS_SHORT = 'M';
+constexpr auto STATS_LONG = "--stats";
+constexpr auto TRACE_SHORT = 'L';
+constexpr auto TRACE_LONG = "--trace";
+constexpr auto DISABLE_RULES_SHORT = 'D';
+constexpr auto DISABLE_RULES_LONG = "--disable-rules";
+constexpr auto ADAPTIVE_RULES_SHORT = 'a';
+constexpr auto ADAPTIVE_RULES_LONG = "--adaptive-rules";
+constexpr auto MOVE_ORDERING_SHORT = 'm';
+constexpr auto MOVE_ORDERING_LONG = "--move-ordering";
+constexpr auto RESYNTHESIZE_SHORT = 'O';
+constexpr auto RESYNTHESIZE_LONG = "--resynthesize";
+constexpr auto CUT_SIZE_SHORT = 'k';
+constexpr auto CUT_SIZE_LONG = "--cut-size";
+constexpr auto SERVE_SHORT = 'S';
+constexpr auto SERVE_LONG = "--serve";
+constexpr auto QUERY_SHORT = 'Q';
+constexpr auto QUERY_LONG = "--query";
 constexpr auto TOKENIZE_SHORT = 'Z';
 constexpr auto TOKENIZE_LONG = "--tokenize";
 constexpr auto POLISH_SHORT = 'P';
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "evaluate.hpp"
+#include "trace.hpp"
+
+namespace {
+
+/// the bytes of the L1 data cache which a tile should fit into
+constexpr std::size_t TILE_BYTES = 32 * 1024;
+constexpr std::size_t MIN_TILE_WORDS = 64;
+constexpr std::size_t MAX_TILE_WORDS = 4096;
+/// the fewest words which are worth a thread of their own
+constexpr std::size_t MIN_WORDS_PER_THREAD = std::size_t{1} << 16;
+
+using Kernel = void (*)(const std::uint64_t *, const std::uint64_t *, std::uint64_t *, std::size_t) noexcept;
+
+/// Applies the operation to every word, in a loop which the compiler vectorizes for the target.
+template <Op O>
+void apply(const std::uint64_t *const a,
+           const std::uint64_t *const b,
+           std::uint64_t *const result,
+           const std::size_t count) noexcept
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        result[i] = op_apply(O, a[i], b[i]);
+    }
+}
+
+#define BOOLEXPR_ENUM_ACTION(e) &apply<Op::e>,
+constexpr Kernel KERNELS[]{BOOLEXPR_ENUM_LIST_OP};
+#undef BOOLEXPR_ENUM_ACTION
+
+/// where a value lives during the evaluation of a tile
+struct Location {
+    enum class Kind : unsigned char { COLUMN, BUFFER, OUTPUT };
+
+    Kind kind;
+    /// the index of the column or buffer
+    unsigned index;
+};
+
+/// one instruction of the program, with the locations of its operands and its result
+struct Step {
+    Kernel kernel;
+    Location a;
+    Location b;
+    Location result;
+};
+
+/// the instructions which the result depends on, with buffers assigned to their values
+struct Plan {
+    std::vector<Step> steps;
+    std::size_t buffers = 0;
+};
+
+[[nodiscard]] Plan make_plan(const Program &program)
+{
+    const std::size_t size = program.size();
+    std::vector<bool> live(size);
+    std::vector<std::size_t> ends(size);
+    live[size - 1] = true;
+    for (std::size_t i = size; i-- > 0;) {
+        if (not live[i]) {
+            continue;
+        }
+        ends[i] = std::max(ends[i], i);
+        const Instruction ins = program[i];
+        const Op op = static_cast<Op>(ins.op);
+        for (const auto &[used, operand] : {std::pair{op_uses_a(op), ins.a}, std::pair{op_uses_b(op), ins.b}}) {
+            if (used && operand >= VARIABLE_COUNT) {
+                live[operand - VARIABLE_COUNT] = true;
+                ends[operand - VARIABLE_COUNT] = std::max(ends[operand - VARIABLE_COUNT], i);
+            }
+        }
+    }
+
+    Plan plan;
+    std::vector<unsigned> buffers(size);
+    std::vector<unsigned> free_buffers;
+    std::vector<std::size_t> active;
+    const auto location_of = [&](const unsigned operand) -> Location {
+        if (operand < VARIABLE_COUNT) {
+            return {Location::Kind::COLUMN, operand};
+        }
+        return {Location::Kind::BUFFER, buffers[operand - VARIABLE_COUNT]};
+    };
+
+    for (std::size_t i = 0; i < size; ++i) {
+        if (not live[i]) {
+            continue;
+        }
+        // operands whose last use is this instruction keep their buffers, so that no result overwrites an operand
+        const auto expired = std::partition(active.begin(), active.end(), [&](const std::size_t j) {
+            return ends[j] >= i;
+        });
+        for (auto it = expired; it != active.end(); ++it) {
+            free_buffers.push_back(buffers[*it]);
+        }
+        active.erase(expired, active.end());
+
+        const Instruction ins = program[i];
+        const Op op = static_cast<Op>(ins.op);
+        Location result{Location::Kind::OUTPUT, 0};
+        if (i + 1 != size) {
+            if (free_buffers.empty()) {
+                free_buffers.push_back(static_cast<unsigned>(plan.buffers++));
+            }
+            buffers[i] = free_buffers.back();
+            free_buffers.pop_back();
+            active.push_back(i);
+            result = {Location::Kind::BUFFER, buffers[i]};
+        }
+        // operands which the operation ignores are never read, any valid location will do
+        const Location a = op_uses_a(op) ? location_of(ins.a) : result;
+        const Location b = op_uses_b(op) ? location_of(ins.b) : result;
+        plan.steps.push_back({KERNELS[ins.op], a, b, result});
+    }
+    return plan;
+}
+
+/// Evaluates consecutive tiles, where the buffers have room for all values of one tile.
+void evaluate_tiles(const Plan &plan,
+                    const std::uint64_t *const *const columns,
+                    std::uint64_t *const out,
+                    std::uint64_t *const buffers,
+                    const std::size_t tile_words,
+                    const std::size_t begin,
+                    const std::size_t end) noexcept
+{
+    for (std::size_t tile = begin; tile < end; tile += tile_words) {
+        const std::size_t count = std::min(tile_words, end - tile);
+        const auto destination = [&](const Location location) -> std::uint64_t * {
+            return location.kind == Location::Kind::OUTPUT ? out + tile : buffers + location.index * tile_words;
+        };
+        const auto source = [&](const Location location) -> const std::uint64_t * {
+            return location.kind == Location::Kind::COLUMN ? columns[location.index] + tile : destination(location);
+        };
+        for (const Step &step : plan.steps) {
+            step.kernel(source(step.a), source(step.b), destination(step.result), count);
+        }
+    }
+}
+
+}  // namespace
+
+void evaluate_columns(const Program &program,
+                      const std::uint64_t *const *const columns,
+                      std::uint64_t *const out,
+                      const std::size_t words,
+                      const EvaluationOptions &options)
+{
+    if (program.empty()) {
+        std::fill(out, out + words, std::uint64_t{0});
+        return;
+    }
+    const Plan plan = make_plan(program);
+
+    const std::size_t streams = plan.buffers + program.variables + 1;
+    std::size_t tile_words = options.tile_words;
+    if (tile_words == 0) {
+        tile_words = std::clamp(TILE_BYTES / sizeof(std::uint64_t) / streams, MIN_TILE_WORDS, MAX_TILE_WORDS);
+        tile_words -= tile_words % 8;
+    }
+
+    const std::size_t tiles = (words + tile_words - 1) / tile_words;
+    const std::size_t max_threads = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+    const std::size_t thread_count =
+        std::max(std::size_t{1}, std::min({max_threads, tiles, words / MIN_WORDS_PER_THREAD}));
+
+    // every thread evaluates a contiguous range of tiles in its own buffers, the calling thread the last one
+    std::vector<std::uint64_t> buffers(thread_count * plan.buffers * tile_words);
+    const auto run = [&](const std::size_t t) {
+        const std::size_t begin = tiles * t / thread_count * tile_words;
+        const std::size_t end = std::min(words, tiles * (t + 1) / thread_count * tile_words);
+        const TraceScope trace{"evaluate tiles", "words", end - begin};
+        evaluate_tiles(plan, columns, out, buffers.data() + t * plan.buffers * tile_words, tile_words, begin, end);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (std::size_t t = 0; t + 1 < thread_count; ++t) {
+        threads.emplace_back(run, t);
+    }
+    run(thread_count - 1);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef EVALUATE_HPP
+#define EVALUATE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "program.hpp"
+
+struct EvaluationOptions {
+    /// the number of threads which evaluate tiles in parallel, zero for one per hardware thread
+    unsigned threads = 0;
+    /// the number of words of each tile, zero to choose it so that the values of a tile stay in the L1 cache
+    std::size_t tile_words = 0;
+};
+
+/// Evaluates the program on bit-packed columns, where every bit of a word is one row:
+/// out[i] is the result of the program for columns[0][i], ..., columns[variables - 1][i], for every i < words.
+/// The columns are split into tiles, on which each instruction runs as one vectorizable loop over all words of the tile.
+/// The intermediate values of a tile share buffers wherever their lifetimes don't overlap.
+void evaluate_columns(const Program &program,
+                      const std::uint64_t *const *columns,
+                      std::uint64_t *out,
+                      std::size_t words,
+                      const EvaluationOptions &options = {});
+
+#endif  // EVALUATE_HPP
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <vector>
+
+#include "heuristic.hpp"
+
+namespace {
+
+/// an incompletely specified function, given by the rows in which it must be true and those where it must be false
+struct Function {
+    std::uint64_t on;
+    std::uint64_t off;
+};
+
+/// a product term, where each set bit of the mask removes the corresponding variable from the term
+struct Cube {
+    unsigned value;
+    unsigned mask;
+
+    constexpr bool operator==(const Cube &other) const noexcept
+    {
+        return value == other.value && mask == other.mask;
+    }
+};
+
+[[nodiscard]] std::uint64_t cube_rows(const Cube cube, const std::size_t variables) noexcept
+{
+    std::uint64_t result = 0;
+    for (unsigned row = 0; row < 1u << variables; ++row) {
+        set_bit_if(result, row, (row & ~cube.mask) == cube.value);
+    }
+    return result;
+}
+
+[[nodiscard]] unsigned cube_literals(const Cube cube, const std::size_t variables) noexcept
+{
+    return static_cast<unsigned>(variables) - popcount(cube.mask);
+}
+
+/// Quine-McCluskey: repeatedly merges implicants which differ in exactly one variable.
+[[nodiscard]] std::vector<Cube> prime_implicants(const std::uint64_t rows, const std::size_t variables)
+{
+    std::vector<Cube> current;
+    std::vector<Cube> primes;
+    for (unsigned row = 0; row < 1u << variables; ++row) {
+        if (get_bit(rows, row)) {
+            current.push_back({row, 0});
+        }
+    }
+
+    while (not current.empty()) {
+        std::vector<Cube> next;
+        std::vector<bool> merged(current.size());
+
+        for (std::size_t i = 0; i < current.size(); ++i) {
+            for (std::size_t j = i + 1; j < current.size(); ++j) {
+                const unsigned difference = current[i].value ^ current[j].value;
+                if (current[i].mask != current[j].mask || not is_pow_2(difference)) {
+                    continue;
+                }
+                merged[i] = merged[j] = true;
+                const Cube cube{current[i].value & ~difference, current[i].mask | difference};
+                if (std::find(next.begin(), next.end(), cube) == next.end()) {
+                    next.push_back(cube);
+                }
+            }
+        }
+        for (std::size_t i = 0; i < current.size(); ++i) {
+            if (not merged[i]) {
+                primes.push_back(current[i]);
+            }
+        }
+        current = std::move(next);
+    }
+    return primes;
+}
+
+/// Covers the on-set with prime implicants of on-set and don't-cares, preferring essential primes and then the
+/// primes covering the most uncovered rows.
+[[nodiscard]] std::vector<Cube> minimum_cover(const std::uint64_t on,
+                                              const std::uint64_t dont_care,
+                                              const std::size_t variables)
+{
+    const std::vector<Cube> primes = prime_implicants(on | dont_care, variables);
+    std::vector<std::uint64_t> rows(primes.size());
+    std::transform(primes.begin(), primes.end(), rows.begin(), [variables](const Cube cube) {
+        return cube_rows(cube, variables);
+    });
+
+    std::vector<Cube> result;
+    std::uint64_t uncovered = on;
+
+    for (unsigned row = 0; row < 1u << variables; ++row) {
+        if (not get_bit(uncovered, row)) {
+            continue;
+        }
+        std::size_t covering = 0, count = 0;
+        for (std::size_t i = 0; i < primes.size(); ++i) {
+            if (get_bit(rows[i], row)) {
+                covering = i;
+                ++count;
+            }
+        }
+        if (count == 1) {
+            result.push_back(primes[covering]);
+            uncovered &= ~rows[covering];
+        }
+    }
+
+    while (uncovered != 0) {
+        std::size_t best = 0;
+        unsigned best_gain = 0;
+        for (std::size_t i = 0; i < primes.size(); ++i) {
+            const unsigned gain = popcount(rows[i] & uncovered);
+            const bool better = gain > best_gain ||
+                                (gain == best_gain && cube_literals(primes[i], variables) <
+                                                          cube_literals(primes[best], variables));
+            if (gain != 0 && better) {
+                best = i;
+                best_gain = gain;
+            }
+        }
+        result.push_back(primes[best]);
+        uncovered &= ~rows[best];
+    }
+    return result;
+}
+
+/// builds a program out of instructions of the C instruction set while reusing identical instructions
+struct ProgramBuilder {
+    Program program;
+    bool overflow = false;
+
+    explicit ProgramBuilder(const std::size_t variables) noexcept : program{variables} {}
+
+    unsigned push(const Op op, unsigned a, unsigned b = 0) noexcept
+    {
+        if (op == Op::NOT_A && a >= VARIABLE_COUNT && static_cast<Op>(program[a - VARIABLE_COUNT].op) == Op::NOT_A) {
+            return program[a - VARIABLE_COUNT].a;
+        }
+        if (op_is_commutative(op) && b < a) {
+            std::swap(a, b);
+        }
+        const Instruction ins{static_cast<std::uint8_t>(op), static_cast<std::uint8_t>(a), static_cast<std::uint8_t>(b)};
+        for (std::size_t i = 0; i < program.size(); ++i) {
+            if (program[i] == ins) {
+                return static_cast<unsigned>(i + VARIABLE_COUNT);
+            }
+        }
+        if (program.size() == Program::instruction_count) {
+            overflow = true;
+            return a;
+        }
+        program.push(ins);
+        return static_cast<unsigned>(program.size() - 1 + VARIABLE_COUNT);
+    }
+
+    unsigned push_literal(const unsigned variable, const bool positive) noexcept
+    {
+        return positive ? variable : push(Op::NOT_A, variable);
+    }
+};
+
+[[nodiscard]] std::size_t live_size(const ProgramBuilder &builder, const unsigned result) noexcept
+{
+    return builder.overflow ? ~std::size_t{0} : compact(builder.program, result).size();
+}
+
+unsigned build_cube(ProgramBuilder &builder, const Cube cube, const std::size_t variables)
+{
+    unsigned result = ~0u;
+    for (unsigned v = 0; v < variables; ++v) {
+        if (get_bit(cube.mask, v)) {
+            continue;
+        }
+        const unsigned literal = builder.push_literal(v, get_bit(cube.value, v));
+        result = result == ~0u ? literal : builder.push(Op::AND, result, literal);
+    }
+    return result;
+}
+
+/// Algebraically factors a sum of products by repeatedly dividing it by its most common literal.
+unsigned build_factored(ProgramBuilder &builder, const std::vector<Cube> &cubes, const std::size_t variables)
+{
+    unsigned best_variable = 0, best_count = 0;
+    bool best_positive = false;
+    for (unsigned v = 0; v < variables; ++v) {
+        for (const bool positive : {true, false}) {
+            const auto count = std::count_if(cubes.begin(), cubes.end(), [v, positive](const Cube cube) {
+                return not get_bit(cube.mask, v) && get_bit(cube.value, v) == positive;
+            });
+            if (static_cast<unsigned>(count) > best_count) {
+                best_variable = v;
+                best_positive = positive;
+                best_count = static_cast<unsigned>(count);
+            }
+        }
+    }
+
+    if (best_count <= 1) {
+        unsigned result = ~0u;
+        for (const Cube cube : cubes) {
+            const unsigned term = build_cube(builder, cube, variables);
+            result = result == ~0u ? term : builder.push(Op::OR, result, term);
+        }
+        return result;
+    }
+
+    std::vector<Cube> quotient, remainder;
+    bool quotient_has_one = false;
+    for (const Cube cube : cubes) {
+        if (get_bit(cube.mask, best_variable) || get_bit(cube.value, best_variable) != best_positive) {
+            remainder.push_back(cube);
+            continue;
+        }
+        const Cube divided{cube.value & ~(1u << best_variable), cube.mask | 1u << best_variable};
+        quotient_has_one |= cube_literals(divided, variables) == 0;
+        quotient.push_back(divided);
+    }
+
+    const unsigned literal = builder.push_literal(best_variable, best_positive);
+    const unsigned term =
+        quotient_has_one ? literal : builder.push(Op::AND, literal, build_factored(builder, quotient, variables));
+    return remainder.empty() ? term : builder.push(Op::OR, term, build_factored(builder, remainder, variables));
+}
+
+/// Synthesizes a non-constant function into the builder and returns the operand holding it.
+unsigned synthesize(ProgramBuilder &builder, const Function f, const std::size_t variables)
+{
+    const std::uint64_t mask = truth_table_rows(variables);
+
+    for (unsigned v = 0; v < variables; ++v) {
+        const std::uint64_t rows = VARIABLE_ROWS[v] & mask;
+        if ((f.on & ~rows) == 0 && (f.off & rows) == 0) {
+            return v;
+        }
+        if ((f.on & rows) == 0 && (f.off & ~rows) == 0) {
+            return builder.push(Op::NOT_A, v);
+        }
+    }
+
+    ProgramBuilder best = builder;
+    const unsigned sop_result = build_factored(best, minimum_cover(f.on, ~(f.on | f.off) & mask, variables), variables);
+    std::size_t best_size = live_size(best, sop_result);
+    unsigned best_result = sop_result;
+
+    const auto try_alternative = [&](ProgramBuilder &alternative, const unsigned result) {
+        if (const std::size_t size = live_size(alternative, result); size < best_size) {
+            best = std::move(alternative);
+            best_size = size;
+            best_result = result;
+        }
+    };
+
+    {
+        ProgramBuilder pos = builder;
+        const auto cover = minimum_cover(f.off, ~(f.on | f.off) & mask, variables);
+        const unsigned result = pos.push(Op::NOT_A, build_factored(pos, cover, variables));
+        try_alternative(pos, result);
+    }
+
+    // XOR extraction: f = x xor g, where g does not depend on x
+    for (unsigned v = 0; v < variables; ++v) {
+        const unsigned shift = 1u << v;
+        const std::uint64_t rows = VARIABLE_ROWS[v] & mask;
+        const std::uint64_t g_on = (f.on & ~rows) | (f.off & rows) >> shift;
+        const std::uint64_t g_off = (f.off & ~rows) | (f.on & rows) >> shift;
+        if ((g_on & g_off) != 0) {
+            continue;
+        }
+        ProgramBuilder extracted = builder;
+        const Function g{g_on | g_on << shift, g_off | g_off << shift};
+        const unsigned result = extracted.push(Op::XOR, v, synthesize(extracted, g, variables));
+        try_alternative(extracted, result);
+        // g can be split by every other variable that f can be split by, so trying those would be redundant
+        break;
+    }
+
+    builder = std::move(best);
+    return best_result;
+}
+
+}  // namespace
+
+std::size_t program_length_lower_bound(const TruthTable table, const std::size_t variables) noexcept
+{
+    // every binary instruction can combine at most two values, so n inputs need at least n - 1 instructions
+    const std::size_t essential = popcount(table.relevancy(variables));
+    return essential <= 2 ? 1 : essential - 1;
+}
+
+HeuristicResult find_heuristic_program(ProgramConsumer &consumer, const TruthTable table, const std::size_t variables)
+{
+    const std::size_t lower_bound = program_length_lower_bound(table, variables);
+    const std::uint64_t mask = truth_table_rows(variables);
+    const Function f{table.f & mask, ~table.t & mask};
+
+    if (f.on == 0) {
+        consumer(&FALSE_INSTRUCTION, 1);
+        return {1, lower_bound};
+    }
+    if (f.off == 0) {
+        consumer(&TRUE_INSTRUCTION, 1);
+        return {1, lower_bound};
+    }
+
+    ProgramBuilder builder{variables};
+    const unsigned result = synthesize(builder, f, variables);
+    const Program program = compact(builder.program, result);
+
+    std::array<Instruction, Program::instruction_count> output_buffer;
+    for (std::size_t i = 0; i < program.size(); ++i) {
+        output_buffer[i] = program[i];
+    }
+    consumer(output_buffer.data(), program.size());
+    return {program.size(), lower_bound};
+}
@@ -0,0 +1,28 @@
+#ifndef HEURISTIC_HPP
+#define HEURISTIC_HPP
+
+#include <cstddef>
+
+#include "program.hpp"
+
+struct HeuristicResult {
+    /// the length of the program passed to the consumer
+    std::size_t length;
+    /// a length which no equivalent program can undercut
+    std::size_t lower_bound;
+
+    [[nodiscard]] constexpr bool is_proven_optimal() const noexcept
+    {
+        return length == lower_bound;
+    }
+};
+
+/// Returns a lower bound for the length of any program equivalent to the table.
+[[nodiscard]] std::size_t program_length_lower_bound(TruthTable table, std::size_t variables) noexcept;
+
+/// Quickly synthesizes a single program equivalent to the table and passes it to the consumer.
+/// The program is built from a two-level minimization with algebraic factoring and XOR extraction, so it is not
+/// necessarily optimal.
+HeuristicResult find_heuristic_program(ProgramConsumer &consumer, TruthTable table, std::size_t variables);
+
+#endif  // HEURISTIC_HPP
@@ -0,0 +1,44 @@
+#include "isomorphism.hpp"
+
+std::uint64_t canonical_dag_hash(const Instruction *const ins, const std::size_t count) noexcept
+{
+    std::uint64_t hashes[Program::instruction_count];
+    const auto operand_hash = [&hashes](const unsigned operand) {
+        return operand < 6 ? dag_input_hash(operand) : hashes[operand - 6];
+    };
+
+    for (std::size_t i = 0; i < count; ++i) {
+        hashes[i] = dag_node_hash(static_cast<Op>(ins[i].op), operand_hash(ins[i].a), operand_hash(ins[i].b));
+    }
+    return count == 0 ? 0 : hashes[count - 1];
+}
+
+bool ConcurrentHashSet::insert(const std::uint64_t hash)
+{
+    // the low bits of the hash select the bucket within the shard, so the shard is selected by the high bits
+    Shard &shard = shards[hash >> 58];
+    static_assert(shard_count == 64);
+
+    std::lock_guard<std::mutex> lock{shard.mutex};
+    return shard.hashes.insert(hash).second;
+}
+
+std::size_t ConcurrentHashSet::size()
+{
+    std::size_t result = 0;
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        result += shard.hashes.size();
+    }
+    return result;
+}
+
+void DeduplicatingConsumer::operator()(const Instruction *const ins, const std::size_t count)
+{
+    if (seen.insert(canonical_dag_hash(ins, count))) {
+        consumer(ins, count);
+    }
+    else {
+        ++duplicates;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef ISOMORPHISM_HPP
+#define ISOMORPHISM_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+
+#include "program.hpp"
+
+/// Finalizes a 64-bit hash, so that every input bit affects every output bit.
+[[nodiscard]] constexpr std::uint64_t mix_hash(std::uint64_t x) noexcept
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9u;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebu;
+    return x ^ x >> 31;
+}
+
+/// Returns the hash of an input of a program.
+[[nodiscard]] constexpr std::uint64_t dag_input_hash(const unsigned input) noexcept
+{
+    return mix_hash(input + 1);
+}
+
+/// Returns the hash of the DAG rooted at an instruction, given the hashes of its operands.
+/// The hash does not depend on the order of the operands: swapping them and transposing the operation is the same
+/// DAG. Operands which the operation ignores do not contribute.
+[[nodiscard]] constexpr std::uint64_t dag_node_hash(Op op, std::uint64_t a, std::uint64_t b) noexcept
+{
+    a = op_uses_a(op) ? a : 0;
+    b = op_uses_b(op) ? b : 0;
+    if (a > b) {
+        return mix_hash(mix_hash(b ^ to_underlying(op_transpose(op))) + a);
+    }
+    return mix_hash(mix_hash(a ^ to_underlying(op)) + b);
+}
+
+static_assert(dag_node_hash(Op::AND, 1, 2) == dag_node_hash(Op::AND, 2, 1));
+static_assert(dag_node_hash(Op::A_ANDN_B, 1, 2) == dag_node_hash(Op::B_ANDN_A, 2, 1));
+static_assert(dag_node_hash(Op::NOT_A, 1, 2) == dag_node_hash(Op::NOT_A, 1, 3));
+static_assert(dag_node_hash(Op::A_ANDN_B, 1, 2) != dag_node_hash(Op::A_ANDN_B, 2, 1));
+
+/// Returns a hash of the DAG computing the result of the program, the last instruction.
+/// Programs which only differ in the order of their instructions or in the order of operands have the same hash.
+[[nodiscard]] std::uint64_t canonical_dag_hash(const Instruction *ins, std::size_t count) noexcept;
+
+/// A set of 64-bit hashes which any number of threads can insert into at the same time.
+/// The set is split into shards by the hash, so that threads rarely contend for the same lock.
+class ConcurrentHashSet {
+private:
+    static constexpr std::size_t shard_count = 64;
+    static constexpr std::size_t cache_line = 64;
+
+    struct alignas(cache_line) Shard {
+        std::mutex mutex;
+        std::unordered_set<std::uint64_t> hashes;
+    };
+
+    Shard shards[shard_count];
+
+public:
+    /// Inserts the hash and returns true if it was not in the set before.
+    bool insert(std::uint64_t hash);
+
+    [[nodiscard]] std::size_t size();
+};
+
+/// Forwards only the programs whose DAG has not been forwarded before to another consumer.
+/// Isomorphic programs are recognized by their canonical_dag_hash, so a hash collision may drop a program.
+/// The set of seen programs may be shared by consumers on different threads.
+class DeduplicatingConsumer : public ProgramConsumer {
+private:
+    ProgramConsumer &consumer;
+    ConcurrentHashSet &seen;
+    std::uint64_t duplicates = 0;
+
+public:
+    DeduplicatingConsumer(ProgramConsumer &consumer, ConcurrentHashSet &seen) noexcept
+        : consumer{consumer}, seen{seen}
+    {
+    }
+
+    void operator()(const Instruction *ins, std::size_t count) final;
+
+    /// Returns the number of programs which were dropped by this consumer.
+    [[nodiscard]] std::uint64_t dropped() const noexcept
+    {
+        return duplicates;
+    }
+};
+
+#endif  // ISOMORPHISM_HPP
@@ -0,0 +1,497 @@
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+
+#include "jit.hpp"
+#include "trace.hpp"
+
+#ifdef __x86_64__
+
+namespace {
+
+enum Gpr : unsigned { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RSI = 6, RDI = 7, R8 = 8, R9 = 9, R10 = 10, R11 = 11 };
+
+/// the registers which hold the input arrays during the loops, rdi last because it holds the array of arrays before
+constexpr Gpr INPUT_POINTERS[VARIABLE_COUNT]{R8, R9, R10, R11, RAX, RDI};
+
+/// the vector registers 0 to 11 hold values of the program, the others are reserved
+constexpr unsigned REGISTER_POOL_SIZE = 12;
+/// the registers which operands are loaded into if they are inputs or on the stack
+constexpr unsigned SCRATCH_A = 12;
+constexpr unsigned SCRATCH_B = 13;
+/// the register which results are computed in if they live on the stack
+constexpr unsigned SCRATCH_RESULT = 14;
+/// a register with all bits set, for complements
+constexpr unsigned ONES = 15;
+
+/// the size of a stack slot, enough for a ymm register
+constexpr std::int32_t SLOT_SIZE = 32;
+
+enum class Encoding : unsigned char { SSE, VEX128, VEX256 };
+
+/// the mandatory prefix of an SSE instruction, in the order of the pp field of VEX
+enum class Prefix : unsigned char { NONE, P66, PF3 };
+
+/// an operand of an instruction: a register, memory at base + rcx, or memory at base + displacement
+struct Operand {
+    enum class Kind : unsigned char { REGISTER, INDEXED, DISPLACED };
+
+    Kind kind;
+    unsigned reg;
+    std::int32_t displacement = 0;
+
+    [[nodiscard]] static Operand registr(const unsigned reg) noexcept
+    {
+        return {Kind::REGISTER, reg};
+    }
+
+    [[nodiscard]] static Operand indexed(const Gpr base) noexcept
+    {
+        return {Kind::INDEXED, base};
+    }
+
+    [[nodiscard]] static Operand displaced(const Gpr base, const std::int32_t displacement) noexcept
+    {
+        return {Kind::DISPLACED, base, displacement};
+    }
+};
+
+/// appends encoded x86-64 instructions to a buffer, only the few which the compiled programs need
+class Assembler {
+private:
+    std::vector<std::uint8_t> bytes;
+
+public:
+    [[nodiscard]] const std::vector<std::uint8_t> &code() const noexcept
+    {
+        return bytes;
+    }
+
+    [[nodiscard]] std::size_t position() const noexcept
+    {
+        return bytes.size();
+    }
+
+    void byte(const unsigned b)
+    {
+        bytes.push_back(static_cast<std::uint8_t>(b));
+    }
+
+    void u32(const std::uint32_t x)
+    {
+        for (unsigned i = 0; i < 4; ++i) {
+            byte(x >> (8 * i) & 0xff);
+        }
+    }
+
+    /// Emits the ModRM byte and whatever follows it for the operand, where the base never needs a displacement
+    /// unless it is displaced, because no base is rbp or r13.
+    void modrm(const unsigned reg, const Operand rm)
+    {
+        const unsigned r = (reg & 7) << 3;
+        switch (rm.kind) {
+        case Operand::Kind::REGISTER: byte(0xc0 | r | (rm.reg & 7)); return;
+        case Operand::Kind::INDEXED:
+            byte(0x04 | r);
+            byte(RCX << 3 | (rm.reg & 7));
+            return;
+        case Operand::Kind::DISPLACED:
+            byte(0x80 | r | 0x04);
+            byte(0x20 | (rm.reg & 7));
+            u32(static_cast<std::uint32_t>(rm.displacement));
+            return;
+        }
+    }
+
+    /// Emits an SSE instruction "prefix 0F opcode" or its VEX form, where vvvv is the first source of VEX.
+    void vector(const Encoding encoding,
+                const Prefix prefix,
+                const unsigned opcode,
+                const unsigned reg,
+                const unsigned vvvv,
+                const Operand rm)
+    {
+        const unsigned r = reg >> 3;
+        const unsigned b = rm.reg >> 3;
+        if (encoding == Encoding::SSE) {
+            if (prefix != Prefix::NONE) {
+                byte(prefix == Prefix::P66 ? 0x66 : 0xf3);
+            }
+            if (r != 0 || b != 0) {
+                byte(0x40 | r << 2 | b);
+            }
+            byte(0x0f);
+        }
+        else {
+            byte(0xc4);
+            byte((r ^ 1) << 7 | 1 << 6 | (b ^ 1) << 5 | 0x01);
+            byte((~vvvv & 0xf) << 3 | (encoding == Encoding::VEX256) << 2 | static_cast<unsigned>(prefix));
+        }
+        byte(opcode);
+        modrm(reg, rm);
+    }
+
+    /// Emits an instruction on two 64-bit general purpose registers, "opcode r/m, reg".
+    void gpr(const unsigned opcode, const unsigned reg, const unsigned rm)
+    {
+        byte(0x48 | (reg >> 3) << 2 | rm >> 3);
+        byte(opcode);
+        byte(0xc0 | (reg & 7) << 3 | (rm & 7));
+    }
+
+    /// Emits "op r/m, imm8" for one of the operations of opcode 83, such as 0 for add and 4 for and.
+    void gpr_immediate(const unsigned operation, const unsigned rm, const std::int8_t immediate)
+    {
+        byte(0x48 | rm >> 3);
+        byte(0x83);
+        byte(0xc0 | operation << 3 | (rm & 7));
+        byte(static_cast<std::uint8_t>(immediate));
+    }
+
+    /// Emits "mov reg, [base + displacement]" for a displacement which fits into a byte.
+    void load_gpr(const Gpr reg, const Gpr base, const std::int8_t displacement)
+    {
+        byte(0x48 | (reg >> 3) << 2 | base >> 3);
+        byte(0x8b);
+        byte(0x40 | (reg & 7) << 3 | (base & 7));
+        byte(static_cast<std::uint8_t>(displacement));
+    }
+
+    /// Emits a jump with a placeholder target and returns the position of the placeholder.
+    [[nodiscard]] std::size_t jump(const bool if_above_or_equal)
+    {
+        if (if_above_or_equal) {
+            byte(0x0f);
+            byte(0x83);
+        }
+        else {
+            byte(0xe9);
+        }
+        u32(0);
+        return position() - 4;
+    }
+
+    /// Lets the jump with the placeholder at the given position go to the target.
+    void patch(const std::size_t placeholder, const std::size_t target) noexcept
+    {
+        const auto offset = static_cast<std::uint32_t>(target - (placeholder + 4));
+        for (unsigned i = 0; i < 4; ++i) {
+            bytes[placeholder + i] = static_cast<std::uint8_t>(offset >> (8 * i));
+        }
+    }
+};
+
+/// where the value of every instruction lives while the loops run
+struct Allocation {
+    static constexpr unsigned SPILLED = 0xff;
+
+    /// whether the result depends on the instruction, the others are never computed
+    std::vector<bool> live;
+    /// the vector register of each instruction, or SPILLED
+    std::vector<unsigned> registers;
+    /// the offset from rsp of the stack slot of each spilled instruction
+    std::vector<std::int32_t> slots;
+    std::int32_t frame_size = 0;
+};
+
+/// Assigns registers by linear scan over the live ranges of the instructions, which end at their last use.
+/// If all registers are taken, the value which is alive the longest lives on the stack.
+[[nodiscard]] Allocation allocate_registers(const Program &program)
+{
+    const std::size_t size = program.size();
+    Allocation result;
+    result.live.assign(size, false);
+    result.registers.assign(size, Allocation::SPILLED);
+    result.slots.assign(size, 0);
+
+    std::vector<std::size_t> ends(size);
+    result.live[size - 1] = true;
+    for (std::size_t i = size; i-- > 0;) {
+        if (not result.live[i]) {
+            continue;
+        }
+        ends[i] = std::max(ends[i], i);
+        const Instruction ins = program[i];
+        const Op op = static_cast<Op>(ins.op);
+        for (const auto &[used, operand] : {std::pair{op_uses_a(op), ins.a}, std::pair{op_uses_b(op), ins.b}}) {
+            if (used && operand >= VARIABLE_COUNT) {
+                result.live[operand - VARIABLE_COUNT] = true;
+                ends[operand - VARIABLE_COUNT] = std::max(ends[operand - VARIABLE_COUNT], i);
+            }
+        }
+    }
+
+    const auto spill = [&result](const std::size_t i) {
+        result.registers[i] = Allocation::SPILLED;
+        result.slots[i] = result.frame_size;
+        result.frame_size += SLOT_SIZE;
+    };
+
+    std::vector<std::size_t> active;
+    unsigned free_registers = (1u << REGISTER_POOL_SIZE) - 1;
+    for (std::size_t i = 0; i < size; ++i) {
+        if (not result.live[i]) {
+            continue;
+        }
+        // values whose last use is this instruction keep their registers, so that no result overwrites an operand
+        const auto expired = std::partition(active.begin(), active.end(), [&](const std::size_t j) {
+            return ends[j] >= i;
+        });
+        for (auto it = expired; it != active.end(); ++it) {
+            free_registers |= 1u << result.registers[*it];
+        }
+        active.erase(expired, active.end());
+
+        if (free_registers != 0) {
+            // the number of trailing zeros, i.e. the lowest free register
+            const unsigned reg = popcount(~free_registers & (free_registers - 1));
+            free_registers &= free_registers - 1;
+            result.registers[i] = reg;
+            active.push_back(i);
+            continue;
+        }
+        const auto furthest = std::max_element(active.begin(), active.end(), [&](std::size_t x, std::size_t y) {
+            return ends[x] < ends[y];
+        });
+        if (ends[*furthest] > ends[i]) {
+            result.registers[i] = result.registers[*furthest];
+            spill(*furthest);
+            *furthest = i;
+        }
+        else {
+            spill(i);
+        }
+    }
+    return result;
+}
+
+class JitCompiler {
+private:
+    const Program &program;
+    const Allocation allocation;
+    const bool avx;
+    Assembler assembler;
+
+public:
+    JitCompiler(const Program &program, const bool avx)
+        : program{program}, allocation{allocate_registers(program)}, avx{avx}
+    {
+    }
+
+    [[nodiscard]] std::vector<std::uint8_t> compile()
+    {
+        // rbx holds the end of the arrays in bytes, rdx where the full vectors end, rcx the current offset
+        const auto width = static_cast<std::int8_t>(avx ? 32 : 16);
+        const Encoding wide = avx ? Encoding::VEX256 : Encoding::SSE;
+        const Encoding narrow = avx ? Encoding::VEX128 : Encoding::SSE;
+
+        assembler.byte(0x53);  // push rbx
+        if (allocation.frame_size != 0) {
+            assembler.byte(0x48);  // sub rsp, frame_size
+            assembler.byte(0x81);
+            assembler.byte(0xec);
+            assembler.u32(static_cast<std::uint32_t>(allocation.frame_size));
+        }
+        assembler.gpr(0x89, RDX, RBX);  // mov rbx, rdx
+        assembler.byte(0x48);           // shl rbx, 3
+        assembler.byte(0xc1);
+        assembler.byte(0xe3);
+        assembler.byte(0x03);
+        assembler.gpr(0x89, RBX, RDX);                                    // mov rdx, rbx
+        assembler.gpr_immediate(4, RDX, static_cast<std::int8_t>(-width));  // and rdx, -width
+        for (std::size_t v = 0; v < program.variables; ++v) {
+            assembler.load_gpr(INPUT_POINTERS[v], RDI, static_cast<std::int8_t>(8 * v));
+        }
+        assembler.byte(0x31);  // xor ecx, ecx
+        assembler.byte(0xc9);
+        binary(wide, 0x76, ONES, ONES, ONES);  // pcmpeqd
+
+        emit_loop(wide, RDX, width, true);
+        emit_loop(narrow, RBX, 8, false);
+
+        if (avx) {
+            assembler.byte(0xc5);  // vzeroupper
+            assembler.byte(0xf8);
+            assembler.byte(0x77);
+        }
+        if (allocation.frame_size != 0) {
+            assembler.byte(0x48);  // add rsp, frame_size
+            assembler.byte(0x81);
+            assembler.byte(0xc4);
+            assembler.u32(static_cast<std::uint32_t>(allocation.frame_size));
+        }
+        assembler.byte(0x5b);  // pop rbx
+        assembler.byte(0xc3);  // ret
+        return assembler.code();
+    }
+
+private:
+    /// Emits a loop which evaluates the program on width bytes of the arrays at once, as long as rcx is below end.
+    void emit_loop(const Encoding encoding, const Gpr end, const std::int8_t width, const bool is_wide)
+    {
+        const std::size_t begin = assembler.position();
+        assembler.gpr(0x39, end, RCX);  // cmp rcx, end
+        const std::size_t exit = assembler.jump(true);
+        for (std::size_t i = 0; i < program.size(); ++i) {
+            if (allocation.live[i]) {
+                emit_instruction(encoding, is_wide, i);
+            }
+        }
+        assembler.gpr_immediate(0, RCX, width);  // add rcx, width
+        assembler.patch(assembler.jump(false), begin);
+        assembler.patch(exit, assembler.position());
+    }
+
+    void load(const Encoding encoding, const bool is_wide, const unsigned reg, const Operand memory)
+    {
+        // movdqu or movq
+        assembler.vector(encoding, Prefix::PF3, is_wide ? 0x6f : 0x7e, reg, 0, memory);
+    }
+
+    void store(const Encoding encoding, const bool is_wide, const Operand memory, const unsigned reg)
+    {
+        // movdqu or movq
+        assembler.vector(encoding, is_wide ? Prefix::PF3 : Prefix::P66, is_wide ? 0x7f : 0xd6, reg, 0, memory);
+    }
+
+    void copy(const Encoding encoding, const unsigned d, const unsigned a)
+    {
+        // movdqa
+        assembler.vector(encoding, Prefix::P66, 0x6f, d, 0, Operand::registr(a));
+    }
+
+    /// Emits d = a op b, which SSE can only do in place.
+    void binary(const Encoding encoding, const unsigned opcode, const unsigned d, const unsigned a, const unsigned b)
+    {
+        if (encoding != Encoding::SSE) {
+            assembler.vector(encoding, Prefix::P66, opcode, d, a, Operand::registr(b));
+            return;
+        }
+        if (d != a) {
+            copy(encoding, d, a);
+        }
+        assembler.vector(encoding, Prefix::P66, opcode, d, 0, Operand::registr(b));
+    }
+
+    /// Returns the register which holds the operand, after loading it into scratch if it is in memory.
+    [[nodiscard]] unsigned fetch(const Encoding encoding, const bool is_wide, const unsigned operand, const unsigned scratch)
+    {
+        if (operand < VARIABLE_COUNT) {
+            load(encoding, is_wide, scratch, Operand::indexed(INPUT_POINTERS[operand]));
+            return scratch;
+        }
+        const std::size_t i = operand - VARIABLE_COUNT;
+        if (allocation.registers[i] != Allocation::SPILLED) {
+            return allocation.registers[i];
+        }
+        load(encoding, is_wide, scratch, Operand::displaced(RSP, allocation.slots[i]));
+        return scratch;
+    }
+
+    void emit_instruction(const Encoding encoding, const bool is_wide, const std::size_t i)
+    {
+        constexpr unsigned PAND = 0xdb;
+        constexpr unsigned PANDN = 0xdf;
+        constexpr unsigned POR = 0xeb;
+        constexpr unsigned PXOR = 0xef;
+
+        const Instruction ins = program[i];
+        const Op op = static_cast<Op>(ins.op);
+        const unsigned a = op_uses_a(op) ? fetch(encoding, is_wide, ins.a, SCRATCH_A) : ONES;
+        const unsigned b = op_uses_b(op) ? fetch(encoding, is_wide, ins.b, SCRATCH_B) : ONES;
+        const bool is_spilled = allocation.registers[i] == Allocation::SPILLED;
+        const unsigned d = is_spilled ? SCRATCH_RESULT : allocation.registers[i];
+
+        switch (op) {
+        case Op::FALSE: binary(encoding, PXOR, d, d, d); break;
+        case Op::NOR: binary(encoding, POR, d, a, b); break;
+        case Op::B_ANDN_A: binary(encoding, PANDN, d, a, b); break;
+        case Op::NOT_A: binary(encoding, PXOR, d, a, ONES); break;
+        case Op::A_ANDN_B: binary(encoding, PANDN, d, b, a); break;
+        case Op::NOT_B: binary(encoding, PXOR, d, b, ONES); break;
+        case Op::XOR: binary(encoding, PXOR, d, a, b); break;
+        case Op::NAND: binary(encoding, PAND, d, a, b); break;
+        case Op::AND: binary(encoding, PAND, d, a, b); break;
+        case Op::NXOR: binary(encoding, PXOR, d, a, b); break;
+        case Op::B: copy(encoding, d, b); break;
+        case Op::A_CONS_B: binary(encoding, PANDN, d, b, a); break;
+        case Op::A: copy(encoding, d, a); break;
+        case Op::B_CONS_A: binary(encoding, PANDN, d, a, b); break;
+        case Op::OR: binary(encoding, POR, d, a, b); break;
+        case Op::TRUE: copy(encoding, d, ONES); break;
+        }
+        // the complements of the operations above
+        if (op == Op::NOR || op == Op::NAND || op == Op::NXOR || op == Op::A_CONS_B || op == Op::B_CONS_A) {
+            binary(encoding, PXOR, d, d, ONES);
+        }
+
+        if (is_spilled) {
+            store(encoding, is_wide, Operand::displaced(RSP, allocation.slots[i]), d);
+        }
+        if (i + 1 == program.size()) {
+            store(encoding, is_wide, Operand::indexed(RSI), d);
+        }
+    }
+};
+
+[[nodiscard]] bool supports_avx2() noexcept
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+}  // namespace
+
+#endif
+
+JitProgram::JitProgram(JitProgram &&other) noexcept
+    : code{std::exchange(other.code, nullptr)}, code_size{std::exchange(other.code_size, 0)}
+{
+}
+
+JitProgram &JitProgram::operator=(JitProgram &&other) noexcept
+{
+    std::swap(code, other.code);
+    std::swap(code_size, other.code_size);
+    return *this;
+}
+
+JitProgram::~JitProgram()
+{
+    if (code != nullptr) {
+        munmap(code, code_size);
+    }
+}
+
+Result<JitProgram> JitProgram::compile(const Program &program, const JitTarget target)
+{
+    const TraceScope trace{"jit compile", "instructions", program.size()};
+#ifdef __x86_64__
+    if (program.empty()) {
+        return Error{ErrorCode::UNSUPPORTED, "Cannot compile an empty program"};
+    }
+    if (target == JitTarget::AVX2 && not supports_avx2()) {
+        return Error{ErrorCode::UNSUPPORTED, "The processor does not support AVX2"};
+    }
+    const bool avx = target == JitTarget::AVX2 || (target == JitTarget::NATIVE && supports_avx2());
+    const std::vector<std::uint8_t> machine_code = JitCompiler{program, avx}.compile();
+
+    void *const memory =
+        mmap(nullptr, machine_code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return Error{ErrorCode::INTERNAL, "Failed to allocate memory for machine code"};
+    }
+    std::memcpy(memory, machine_code.data(), machine_code.size());
+    if (mprotect(memory, machine_code.size(), PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, machine_code.size());
+        return Error{ErrorCode::INTERNAL, "Failed to make machine code executable"};
+    }
+    return JitProgram{memory, machine_code.size()};
+#else
+    static_cast<void>(program);
+    static_cast<void>(target);
+    return Error{ErrorCode::UNSUPPORTED, "Programs can only be compiled to x86-64 code"};
+#endif
+}
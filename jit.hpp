@@ -0,0 +1,58 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "program.hpp"
+#include "result.hpp"
+
+/// the vector extension which compiled programs use
+enum class JitTarget : unsigned char {
+    /// AVX2 if the processor supports it, otherwise SSE2
+    NATIVE,
+    SSE2,
+    AVX2,
+};
+
+/// A program compiled to native x86-64 code, which evaluates it on bit-packed rows.
+/// The values of the program are kept in vector registers where possible; only if more of them are alive at once than
+/// there are registers, some live on the stack instead.
+class JitProgram {
+public:
+    /// Computes out[i] from inputs[v][i] for every i < n, where inputs has one array for every variable.
+    using function_type = void(const std::uint64_t *const *inputs, std::uint64_t *out, std::size_t n);
+
+private:
+    void *code = nullptr;
+    std::size_t code_size = 0;
+
+    JitProgram(void *code, std::size_t code_size) noexcept : code{code}, code_size{code_size} {}
+
+public:
+    JitProgram(JitProgram &&other) noexcept;
+    JitProgram &operator=(JitProgram &&other) noexcept;
+    ~JitProgram();
+
+    /// Compiles a program, which fails on anything but x86-64, if the processor does not support the target or if
+    /// the program is empty.
+    [[nodiscard]] static Result<JitProgram> compile(const Program &program, JitTarget target = JitTarget::NATIVE);
+
+    [[nodiscard]] function_type *function() const noexcept
+    {
+        return reinterpret_cast<function_type *>(code);
+    }
+
+    /// Returns the size of the machine code in bytes.
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return code_size;
+    }
+
+    void operator()(const std::uint64_t *const *inputs, std::uint64_t *out, std::size_t n) const noexcept
+    {
+        function()(inputs, out, n);
+    }
+};
+
+#endif  // JIT_HPP
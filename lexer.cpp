@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <optional>
+#include <string>
 
 #include "lexer.hpp"
+#include "trace.hpp"
 
 namespace {
 
@@ -26,32 +31,41 @@ namespace {
 }
 #endif
 
-[[nodiscard]] constexpr TokenType token_of_word(std::string_view word) noexcept
-{
-    switch (tiny_string(word)) {
-    case tiny_string("and"): return TokenType::AND;
-
-    case tiny_string("nand"):
-    case tiny_string("notand"): return TokenType::NAND;
-
-    case tiny_string("or"): return TokenType::OR;
-
-    case tiny_string("nor"):
-    case tiny_string("notor"): return TokenType::NOR;
-
-    case tiny_string("xor"): return TokenType::XOR;
-
-    case tiny_string("nxor"):
-    case tiny_string("notxor"): return TokenType::NXOR;
+struct Keyword {
+    std::string_view spelling;
+    TokenType type;
+};
 
-    case tiny_string("andn"):
-    case tiny_string("andnot"): return TokenType::ANDN;
+constexpr Keyword KEYWORDS[]{
+    {"and", TokenType::AND},
+    {"nand", TokenType::NAND},
+    {"notand", TokenType::NAND},
+    {"or", TokenType::OR},
+    {"nor", TokenType::NOR},
+    {"notor", TokenType::NOR},
+    {"xor", TokenType::XOR},
+    {"nxor", TokenType::NXOR},
+    {"notxor", TokenType::NXOR},
+    {"andn", TokenType::ANDN},
+    {"andnot", TokenType::ANDN},
+    {"not", TokenType::NOT},
+};
 
-    case tiny_string("not"): return TokenType::NOT;
-    default: return TokenType::EMPTY;
+/// Returns the keyword matching the word regardless of case, whose spelling is stored statically unlike the word.
+[[nodiscard]] constexpr const Keyword *find_keyword(const std::string_view word) noexcept
+{
+    const std::uint64_t key = tiny_string(word);
+    for (const Keyword &keyword : KEYWORDS) {
+        if (tiny_string(keyword.spelling) == key) {
+            return &keyword;
+        }
     }
+    return nullptr;
 }
 
+static_assert(find_keyword("AndNot")->type == TokenType::ANDN);
+static_assert(find_keyword("andnota") == nullptr);
+
 [[nodiscard]] constexpr TokenType token_type_of_char(char c) noexcept
 {
     switch (c) {
@@ -65,20 +79,43 @@ namespace {
     }
 }
 
+[[nodiscard]] constexpr std::string_view char_spelling(const char c) noexcept
+{
+    constexpr std::string_view chars = "~+*^()!=&|";
+    return chars.substr(chars.find(c), 1);
+}
+
+[[nodiscard]] constexpr bool is_space(const char c) noexcept
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/// A tokenizer which is fed the input in chunks, so that it never has to be held in memory as a whole.
+/// Literals are sliced out of the chunk they were found in and only copied once per distinct name into the symbol
+/// table; they are only buffered if they cross a chunk boundary.
 struct ExpressionTokenizer {
-    std::vector<Token> tokens;
-    std::string literal;
+    TokenList result;
+    /// the current chunk of the input
+    std::string_view chunk;
+    /// the position of the current chunk in the whole input
+    std::size_t offset = 0;
     std::size_t i = 0;
-    std::string_view expr;
+    /// the state of the automaton, where 'E' means that an error was found and everything else is ignored
+    char state = ' ';
+    std::optional<Error> failure;
+    /// the position in the current chunk where the literal which is being read starts
+    std::size_t literal_start = 0;
+    /// the part of the literal which is being read that was in previous chunks
+    std::string literal_prefix;
 
-    explicit ExpressionTokenizer(std::string_view expr) : expr{expr} {}
+    void feed(std::string_view chunk);
 
-    void tokenize();
+    void finish();
 
 private:
-    [[noreturn]] void error(std::size_t i, std::string_view msg) noexcept;
+    [[nodiscard]] char error(std::size_t i, std::string_view msg);
 
-    [[noreturn]] void unexpected_token_error();
+    [[nodiscard]] char unexpected_token_error();
 
     [[nodiscard]] char tokenize_after_whitespace(char c);
     [[nodiscard]] char tokenize_in_literal(char c);
@@ -88,62 +125,107 @@ private:
     template <char Start>
     [[nodiscard]] char tokenize_after_double_op(char c);
 
-    void push(TokenType type, std::string value);
+    void step(char c);
+
+    void begin_literal() noexcept
+    {
+        literal_start = i;
+    }
+
+    void push_literal();
+
+    void push(const TokenType type, const std::string_view spelling)
+    {
+        result.tokens.push_back({type, spelling});
+    }
 
     void push(const TokenType type, const char c)
     {
-        tokens.push_back({type, {c}});
+        push(type, char_spelling(c));
     }
 };
 
-void ExpressionTokenizer::push(TokenType type, std::string value)
+void ExpressionTokenizer::push_literal()
 {
-    if (type != TokenType::LITERAL) {
-        tokens.push_back({type, std::move(value)});
+    std::string_view literal = chunk.substr(literal_start, i - literal_start);
+    if (not literal_prefix.empty()) {
+        literal_prefix += literal;
+        literal = literal_prefix;
+    }
+    if (const Keyword *keyword = find_keyword(literal)) {
+        push(keyword->type, keyword->spelling);
     }
     else {
-        if (auto actual_type = token_of_word(value); actual_type != TokenType::EMPTY) {
-            type = actual_type;
-        }
-        tokens.push_back({type, std::move(value)});
+        const std::uint32_t symbol = result.symbols.intern(literal);
+        result.tokens.push_back({TokenType::LITERAL, result.symbols[symbol], symbol});
     }
+    literal_prefix.clear();
 }
 
-[[noreturn]] void ExpressionTokenizer::error(std::size_t i, std::string_view msg) noexcept
+char ExpressionTokenizer::error(std::size_t i, std::string_view msg)
 {
     constexpr const char *indent = "        ";
-    std::cout << "Parse error at index " << i << ": " << msg << '\n';
-    std::cout << indent << '"' << expr << "\"\n";
-    std::cout << indent << std::string(i + 1, ' ') << "^\n";
-    std::exit(1);
+    constexpr std::size_t context = 40;
+    const std::size_t line_begin = i == 0 ? 0 : chunk.rfind('\n', i - 1) + 1;
+    const std::size_t begin = std::max(line_begin, i > context ? i - context : 0);
+    const std::size_t end = std::min(chunk.find('\n', i), i + context);
+
+    std::string message = "Parse error at index " + std::to_string(offset + i) + ": ";
+    message += msg;
+    message += "\n";
+    message += indent;
+    message += '"';
+    message += chunk.substr(begin, end - begin);
+    message += "\"\n";
+    message += indent;
+    message += std::string(i - begin + 1, ' ');
+    message += '^';
+    failure = Error{ErrorCode::SYNTAX_ERROR, std::move(message)};
+    return 'E';
 }
 
-[[noreturn]] void ExpressionTokenizer::unexpected_token_error()
+char ExpressionTokenizer::unexpected_token_error()
 {
-    error(i, std::string("Unexpected token '") + expr[i] + '\'');
+    return error(i, std::string("Unexpected token '") + chunk[i] + '\'');
 }
 
-void ExpressionTokenizer::tokenize()
+void ExpressionTokenizer::feed(const std::string_view next_chunk)
 {
-    char state = ' ';
-    for (i = 0; i <= expr.length(); ++i) {
-        const char c = i == expr.length() ? ' ' : expr[i];
-
-        switch (state) {
-        case ' ': state = tokenize_after_whitespace(c); break;
-        case 'a': state = tokenize_in_literal(c); break;
-        case '!': state = tokenize_after_exclamation(c); break;
-        case '=': state = tokenize_after_equals(c); break;
-        case '&': state = tokenize_after_double_op<'&'>(c); break;
-        case '|': state = tokenize_after_double_op<'|'>(c); break;
-        }
+    chunk = next_chunk;
+    for (i = 0; i < chunk.length() && state != 'E'; ++i) {
+        step(is_space(chunk[i]) ? ' ' : chunk[i]);
+    }
+    if (state == 'a') {
+        literal_prefix += chunk.substr(literal_start);
+        literal_start = 0;
+    }
+    offset += chunk.length();
+}
+
+void ExpressionTokenizer::finish()
+{
+    chunk = {};
+    i = 0;
+    step(' ');
+}
+
+void ExpressionTokenizer::step(const char c)
+{
+    switch (state) {
+    case ' ': state = tokenize_after_whitespace(c); break;
+    case 'a': state = tokenize_in_literal(c); break;
+    case '!': state = tokenize_after_exclamation(c); break;
+    case '=': state = tokenize_after_equals(c); break;
+    case '&': state = tokenize_after_double_op<'&'>(c); break;
+    case '|': state = tokenize_after_double_op<'|'>(c); break;
+    case 'E': break;
     }
 }
 
 char ExpressionTokenizer::tokenize_after_whitespace(const char c)
 {
     if (is_alphanum(c)) {
-        literal = {c};
+        begin_literal();
         return 'a';
     }
     switch (c) {
@@ -158,14 +240,13 @@ char ExpressionTokenizer::tokenize_after_whitespace(const char c)
     case '|':
     case '&':
     case '=': return c;
-    default: unexpected_token_error();
+    default: return unexpected_token_error();
     }
 }
 
 char ExpressionTokenizer::tokenize_in_literal(const char c)
 {
     if (is_alphanum(c)) {
-        literal.push_back(c);
         return 'a';
     }
     switch (c) {
@@ -175,15 +256,15 @@ char ExpressionTokenizer::tokenize_in_literal(const char c)
     case '^':
     case '(':
     case ')':
-        push(TokenType::LITERAL, std::move(literal));
+        push_literal();
         push(token_type_of_char(c), c);
         return ' ';
     case ' ':
     case '!':
     case '|':
     case '&':
-    case '=': push(TokenType::LITERAL, std::move(literal)); return c;
-    default: unexpected_token_error();
+    case '=': push_literal(); return c;
+    default: return unexpected_token_error();
     }
 }
 
@@ -191,7 +272,7 @@ char ExpressionTokenizer::tokenize_after_exclamation(const char c)
 {
     if (c == ' ' || is_alphanum(c)) {
         push(TokenType::NOT, '!');
-        literal = {c};
+        begin_literal();
         return c == ' ' ? ' ' : 'a';
     }
     switch (c) {
@@ -206,15 +287,15 @@ char ExpressionTokenizer::tokenize_after_exclamation(const char c)
         return ' ';
     case '!': push(TokenType::NOT, '!'); return '!';
     case '=': push(TokenType::XOR, "!="); return ' ';
-    default: unexpected_token_error();
+    default: return unexpected_token_error();
     }
 }
 
 char ExpressionTokenizer::tokenize_after_equals(const char c)
 {
     if (c == ' ' || is_alphanum(c)) {
-        push(TokenType::NXOR, "=");
-        literal = {c};
+        push(TokenType::NXOR, '=');
+        begin_literal();
         return c == ' ' ? ' ' : 'a';
     }
     switch (c) {
@@ -232,7 +313,7 @@ char ExpressionTokenizer::tokenize_after_equals(const char c)
     case '!':
     case '|':
     case '&': push(TokenType::NXOR, '='); return c;
-    default: unexpected_token_error();
+    default: return unexpected_token_error();
     }
 }
 
@@ -244,7 +325,7 @@ char ExpressionTokenizer::tokenize_after_double_op(const char c)
 
     if (c == ' ' || is_alphanum(c)) {
         push(type, Start);
-        literal = {c};
+        begin_literal();
         return c == ' ' ? ' ' : 'a';
     }
     switch (c) {
@@ -257,9 +338,9 @@ char ExpressionTokenizer::tokenize_after_double_op(const char c)
         push(type, Start);
         push(token_type_of_char(c), c);
         return ' ';
-    case Start: push(type, std::string(2, Start)); return ' ';
+    case Start: push(type, Start == '&' ? "&&" : "||"); return ' ';
     case Start == '&' ? '|': '&' : push(type, Start); return c;
-    default: unexpected_token_error();
+    default: return unexpected_token_error();
     }
 }
 
@@ -270,9 +351,53 @@ std::ostream &operator<<(std::ostream &out, const Token &token)
     return out << token_label(token.type) << ":\"" << token.value << '"';
 }
 
-std::vector<Token> tokenize(std::string_view expr)
+std::uint32_t SymbolTable::intern(const std::string_view name)
+{
+    if (const auto it = ids.find(name); it != ids.end()) {
+        return it->second;
+    }
+    if (name.size() > capacity - used) {
+        capacity = std::max(BLOCK_SIZE, name.size());
+        blocks.push_back(std::make_unique<char[]>(capacity));
+        used = 0;
+    }
+    char *const stored = blocks.back().get() + used;
+    std::memcpy(stored, name.data(), name.size());
+    used += name.size();
+
+    const auto id = static_cast<std::uint32_t>(names.size());
+    names.emplace_back(stored, name.size());
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+Result<TokenList> tokenize(const std::string_view expr)
 {
-    ExpressionTokenizer tokenizer{expr};
-    tokenizer.tokenize();
-    return tokenizer.tokens;
+    const TraceScope trace{"tokenize", "bytes", expr.size()};
+    ExpressionTokenizer tokenizer;
+    tokenizer.result.tokens.reserve(expr.size() / 2);
+    tokenizer.feed(expr);
+    tokenizer.finish();
+    if (tokenizer.failure.has_value()) {
+        return std::move(*tokenizer.failure);
+    }
+    return std::move(tokenizer.result);
+}
+
+Result<TokenList> tokenize(std::istream &in)
+{
+    const TraceScope trace{"tokenize"};
+    constexpr std::size_t chunk_size = std::size_t{1} << 16;
+    const std::unique_ptr<char[]> buffer = std::make_unique<char[]>(chunk_size);
+
+    ExpressionTokenizer tokenizer;
+    while (in && tokenizer.state != 'E') {
+        in.read(buffer.get(), chunk_size);
+        tokenizer.feed({buffer.get(), static_cast<std::size_t>(in.gcount())});
+    }
+    tokenizer.finish();
+    if (tokenizer.failure.has_value()) {
+        return std::move(*tokenizer.failure);
+    }
+    return std::move(tokenizer.result);
 }
@@ -1,11 +1,15 @@
 #ifndef PARSE_HPP
 #define PARSE_HPP
 
+#include <cstdint>
 #include <iosfwd>
-#include <string>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "program.hpp"
+#include "result.hpp"
 
 #define BOOLEXPR_ENUM_LIST_TOKEN_TYPE \
     BOOLEXPR_ENUM_ACTION(EMPTY)       \
@@ -37,13 +41,51 @@ enum class TokenType : unsigned { BOOLEXPR_ENUM_LIST_TOKEN_TYPE };
 }
 #undef BOOLEXPR_ENUM_ACTION
 
+/// Interns symbol names, so that every distinct name is stored only once and identified by a small integer.
+/// Ids are handed out in order of first appearance.
+class SymbolTable {
+private:
+    static constexpr std::size_t BLOCK_SIZE = std::size_t{1} << 12;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t used = 0;
+    std::size_t capacity = 0;
+    std::vector<std::string_view> names;
+    std::unordered_map<std::string_view, std::uint32_t> ids;
+
+public:
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return names.size();
+    }
+
+    [[nodiscard]] std::string_view operator[](const std::uint32_t id) const noexcept
+    {
+        return names[id];
+    }
+
+    /// Returns the id of the name, copying it into the table if it wasn't seen before.
+    std::uint32_t intern(std::string_view name);
+};
+
 struct Token {
     TokenType type;
-    std::string value;
+    /// the spelling of the token, which points into the symbol table for literals and into static storage otherwise
+    std::string_view value;
+    /// the id of the literal in the symbol table
+    std::uint32_t symbol = 0;
+};
+
+struct TokenList {
+    std::vector<Token> tokens;
+    SymbolTable symbols;
 };
 
 std::ostream &operator<<(std::ostream &out, const Token &token);
 
-[[nodiscard]] std::vector<Token> tokenize(std::string_view expr);
+[[nodiscard]] Result<TokenList> tokenize(std::string_view expr);
+
+/// Tokenizes an expression which is read from the stream in chunks.
+[[nodiscard]] Result<TokenList> tokenize(std::istream &in);
 
 #endif  // PARSE_HPP
@@ -1,26 +1,72 @@
 #include <algorithm>
+#include <charconv>
 #include <cstring>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <utility>
 
+#include "anytime.hpp"
+#include "boolexpr.hpp"
+#include "codegen.hpp"
 #include "compiler.hpp"
 #include "constants.hpp"
+#include "heuristic.hpp"
+#include "isomorphism.hpp"
 #include "lexer.hpp"
+#include "netlist_io.hpp"
+#include "ordering.hpp"
+#include "output.hpp"
+#include "portfolio.hpp"
 #include "program.hpp"
+#include "pruning.hpp"
+#include "resynthesis.hpp"
+#include "server.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 
 namespace {
 
+enum class StatsFormat : unsigned char { NONE, TEXT, JSON };
+
 struct LaunchOptions {
     TruthTable table;
     std::size_t table_variables_len = 0;
     std::string expression_str;
+    std::string expression_path;
+    std::string input_path;
+    std::string output_path;
+    std::string serve_path;
+    std::string query_path;
+    /// the file which the timeline of the run is written to, nothing is traced if empty
+    std::string trace_path;
+    /// the name of the functions emitted as C++, nothing is emitted if empty
+    std::string emit_name;
     SymbolOrder symbol_order = SymbolOrder::LEX_ASCENDING;
+    SearchLimits limits;
+    std::optional<std::chrono::milliseconds> timeout;
+    /// the number of optimal programs to take, all of them if empty
+    std::optional<std::uint64_t> first;
+    unsigned cut_size = ResynthesisOptions{}.cut_size;
+    /// how the statistics of the search are printed, if at all
+    StatsFormat stats_format = StatsFormat::NONE;
+    /// the rules of can_push which the search ignores
+    std::vector<PushRule> disabled_rules;
 
     bool is_help = false;
 
     bool is_greedy = false;
     bool is_output_expr = false;
     bool is_output_program = false;
+    bool is_output_binary = false;
+    bool is_count = false;
+    bool is_unique = false;
+    bool is_portfolio = false;
+    bool is_heuristic = false;
+    bool is_anytime = false;
+    bool is_resynthesize = false;
+    bool is_adaptive_rules = false;
+    bool is_move_ordering = false;
 
     bool is_tokenize = false;
     bool is_polish = false;
@@ -41,12 +87,51 @@ struct LaunchOptions {
     if (arg[1] == EXPR_SHORT || arg == EXPR_LONG) {
         return 'e';
     }
+    if (arg[1] == EXPR_FILE_SHORT || arg == EXPR_FILE_LONG) {
+        return 'f';
+    }
     if (arg[1] == TABLE_SHORT || arg == TABLE_LONG) {
         return 't';
     }
+    if (arg[1] == INPUT_NETLIST_SHORT || arg == INPUT_NETLIST_LONG) {
+        return 'i';
+    }
+    if (arg[1] == OUTPUT_NETLIST_SHORT || arg == OUTPUT_NETLIST_LONG) {
+        return 'o';
+    }
+    if (arg[1] == EMIT_SHORT || arg == EMIT_LONG) {
+        return 'E';
+    }
     if (arg[1] == SYMBOL_ORDER_SHORT || arg == SYMBOL_ORDER_LONG) {
         return 's';
     }
+    if (arg[1] == TIMEOUT_SHORT || arg == TIMEOUT_LONG) {
+        return 'T';
+    }
+    if (arg[1] == NODE_BUDGET_SHORT || arg == NODE_BUDGET_LONG) {
+        return 'N';
+    }
+    if (arg[1] == STATS_SHORT || arg == STATS_LONG) {
+        return 'M';
+    }
+    if (arg[1] == TRACE_SHORT || arg == TRACE_LONG) {
+        return 'L';
+    }
+    if (arg[1] == DISABLE_RULES_SHORT || arg == DISABLE_RULES_LONG) {
+        return 'D';
+    }
+    if (arg[1] == FIRST_SHORT || arg == FIRST_LONG) {
+        return 'n';
+    }
+    if (arg[1] == CUT_SIZE_SHORT || arg == CUT_SIZE_LONG) {
+        return 'k';
+    }
+    if (arg[1] == SERVE_SHORT || arg == SERVE_LONG) {
+        return 'S';
+    }
+    if (arg[1] == QUERY_SHORT || arg == QUERY_LONG) {
+        return 'Q';
+    }
 
     if (arg[1] == GREEDY_SHORT || arg == GREEDY_LONG) {
         result.is_greedy = true;
@@ -60,6 +145,42 @@ struct LaunchOptions {
         result.is_output_program = true;
         return ' ';
     }
+    if (arg[1] == OUTPUT_BINARY_SHORT || arg == OUTPUT_BINARY_LONG) {
+        result.is_output_binary = true;
+        return ' ';
+    }
+    if (arg[1] == COUNT_SHORT || arg == COUNT_LONG) {
+        result.is_count = true;
+        return ' ';
+    }
+    if (arg[1] == UNIQUE_SHORT || arg == UNIQUE_LONG) {
+        result.is_unique = true;
+        return ' ';
+    }
+    if (arg[1] == PORTFOLIO_SHORT || arg == PORTFOLIO_LONG) {
+        result.is_portfolio = true;
+        return ' ';
+    }
+    if (arg[1] == HEURISTIC_SHORT || arg == HEURISTIC_LONG) {
+        result.is_heuristic = true;
+        return ' ';
+    }
+    if (arg[1] == ANYTIME_SHORT || arg == ANYTIME_LONG) {
+        result.is_anytime = true;
+        return ' ';
+    }
+    if (arg[1] == RESYNTHESIZE_SHORT || arg == RESYNTHESIZE_LONG) {
+        result.is_resynthesize = true;
+        return ' ';
+    }
+    if (arg[1] == ADAPTIVE_RULES_SHORT || arg == ADAPTIVE_RULES_LONG) {
+        result.is_adaptive_rules = true;
+        return ' ';
+    }
+    if (arg[1] == MOVE_ORDERING_SHORT || arg == MOVE_ORDERING_LONG) {
+        result.is_move_ordering = true;
+        return ' ';
+    }
 
     if (arg[1] == TOKENIZE_SHORT || arg == TOKENIZE_LONG) {
         result.is_tokenize = true;
@@ -93,6 +214,32 @@ constexpr std::optional<SymbolOrder> order_parse(const std::string_view str) noe
     }
 }
 
+[[nodiscard]] std::optional<std::uint64_t> parse_unsigned(const std::string_view str) noexcept
+{
+    std::uint64_t result = 0;
+    const auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), result);
+    if (error != std::errc{} || end != str.data() + str.size()) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+void print_error(const Error &error)
+{
+    std::cout << error.message << '\n';
+}
+
+/// Returns the value of the result, or prints its error and returns nothing.
+template <typename T>
+[[nodiscard]] std::optional<T> value_or_print_error(Result<T> result)
+{
+    if (not result.has_value()) {
+        print_error(result.error());
+        return std::nullopt;
+    }
+    return std::move(*result);
+}
+
 [[nodiscard]] LaunchOptions parse_program_args(int argc, char **argv)
 {
     LaunchOptions result;
@@ -107,13 +254,87 @@ constexpr std::optional<SymbolOrder> order_parse(const std::string_view str) noe
             break;
         }
 
+        case 'f': {
+            result.expression_path = std::move(arg);
+            state = 0;
+            break;
+        }
+
+        case 'S':
+        case 'Q': {
+            (state == 'S' ? result.serve_path : result.query_path) = std::move(arg);
+            state = 0;
+            break;
+        }
+
         case 't': {
-            arg.erase(std::remove(arg.begin(), arg.end(), '.'), arg.end());
-            if (not TruthTable::is_well_formed(arg)) {
+            const Result<boolexpr::Table> table = boolexpr::parse_table(arg);
+            if (not table.has_value()) {
+                print_error(table.error());
+                std::exit(1);
+            }
+            result.table = table->table;
+            result.table_variables_len = std::size_t{1} << table->variables;
+            state = 0;
+            break;
+        }
+
+        case 'i':
+        case 'o': {
+            if (not netlist_format_of_path(arg).has_value()) {
+                std::cout << "Unknown netlist format of \"" << arg << "\", must end in .blif, .aag, or .aig\n";
+                std::exit(1);
+            }
+            (state == 'i' ? result.input_path : result.output_path) = std::move(arg);
+            state = 0;
+            break;
+        }
+
+        case 'E': {
+            constexpr std::string_view target = "cpp";
+            const std::string_view name = std::string_view{arg}.substr(std::min(target.size() + 1, arg.size()));
+            if (arg.compare(0, target.size(), target) != 0 ||
+                (arg.size() != target.size() && (arg[target.size()] != ':' || not is_cpp_identifier(name)))) {
+                std::cout << "Invalid emit target \"" << arg << "\", must be cpp or cpp:NAME\n";
+                std::exit(1);
+            }
+            result.emit_name = arg.size() == target.size() ? "predicate" : std::string{name};
+            state = 0;
+            break;
+        }
+
+        case 'D': {
+            for (std::size_t begin = 0; begin <= arg.size();) {
+                const std::size_t end = std::min(arg.find(',', begin), arg.size());
+                const std::optional<PushRule> rule = push_rule_parse(std::string_view{arg}.substr(begin, end - begin));
+                if (not rule.has_value()) {
+                    std::cout << "Invalid rules \"" << arg << "\", must be numbers from 1 to 7 or names of rules\n";
+                    std::exit(1);
+                }
+                result.disabled_rules.push_back(*rule);
+                begin = end + 1;
+            }
+            state = 0;
+            break;
+        }
+
+        case 'L': {
+            result.trace_path = std::move(arg);
+            state = 0;
+            break;
+        }
+
+        case 'M': {
+            if (arg == "text") {
+                result.stats_format = StatsFormat::TEXT;
+            }
+            else if (arg == "json") {
+                result.stats_format = StatsFormat::JSON;
+            }
+            else {
+                std::cout << "Invalid statistics format \"" << arg << "\", must be text or json\n";
                 std::exit(1);
             }
-            result.table = TruthTable::parse(arg);
-            result.table_variables_len = arg.length();
             state = 0;
             break;
         }
@@ -125,6 +346,52 @@ constexpr std::optional<SymbolOrder> order_parse(const std::string_view str) noe
                 std::exit(1);
             }
             result.symbol_order = *order;
+            state = 0;
+            break;
+        }
+
+        case 'T': {
+            const std::optional<std::uint64_t> millis = parse_unsigned(arg);
+            if (not millis.has_value()) {
+                std::cout << "Invalid timeout \"" << arg << "\", must be a number of milliseconds\n";
+                std::exit(1);
+            }
+            result.timeout = std::chrono::milliseconds{*millis};
+            result.limits.deadline = std::chrono::steady_clock::now() + *result.timeout;
+            state = 0;
+            break;
+        }
+
+        case 'N': {
+            const std::optional<std::uint64_t> budget = parse_unsigned(arg);
+            if (not budget.has_value()) {
+                std::cout << "Invalid node budget \"" << arg << "\", must be a number\n";
+                std::exit(1);
+            }
+            result.limits.node_budget = *budget;
+            state = 0;
+            break;
+        }
+
+        case 'n': {
+            const std::optional<std::uint64_t> first = parse_unsigned(arg);
+            if (not first.has_value() || *first == 0) {
+                std::cout << "Invalid program count \"" << arg << "\", must be a positive number\n";
+                std::exit(1);
+            }
+            result.first = *first;
+            state = 0;
+            break;
+        }
+
+        case 'k': {
+            const std::optional<std::uint64_t> size = parse_unsigned(arg);
+            if (not size.has_value() || *size == 0 || *size > VARIABLE_COUNT) {
+                std::cout << "Invalid cut size \"" << arg << "\", must be in [1, " << VARIABLE_COUNT << "]\n";
+                std::exit(1);
+            }
+            result.cut_size = static_cast<unsigned>(*size);
+            state = 0;
             break;
         }
 
@@ -137,6 +404,25 @@ constexpr std::optional<SymbolOrder> order_parse(const std::string_view str) noe
         }
     }
 
+    if (result.first.has_value()) {
+        // the enumerator only runs the plain greedy search, so it would silently ignore these
+        const std::pair<bool, const char *> unsupported[] = {
+            {result.is_anytime, ANYTIME_LONG},
+            {result.is_heuristic, HEURISTIC_LONG},
+            {result.is_portfolio, PORTFOLIO_LONG},
+            {result.stats_format != StatsFormat::NONE, STATS_LONG},
+            {not result.disabled_rules.empty(), DISABLE_RULES_LONG},
+            {result.is_adaptive_rules, ADAPTIVE_RULES_LONG},
+            {result.is_move_ordering, MOVE_ORDERING_LONG},
+        };
+        for (const auto &[is_set, option] : unsupported) {
+            if (is_set) {
+                std::cout << "Option " << FIRST_LONG << " can't be combined with " << option << '\n';
+                std::exit(1);
+            }
+        }
+    }
+
     return result;
 }
 
@@ -159,12 +445,40 @@ constexpr std::optional<SymbolOrder> order_parse(const std::string_view str) noe
 
     out << "\nInput options:\n";
     print(EXPR_SHORT, EXPR_LONG, "input expression", " EXPRESSION");
+    print(EXPR_FILE_SHORT, EXPR_FILE_LONG, "read input expression from file, - for stdin", " FILE");
     print(TABLE_SHORT, TABLE_LONG, "input truth table", " TABLE");
+    print(INPUT_NETLIST_SHORT, INPUT_NETLIST_LONG, "input netlist (.blif, .aag, .aig)", " FILE");
 
     out << "\nOutput flags:\n";
     print(GREEDY_SHORT, GREEDY_LONG, "greedily search for all optimal programs");
+    print(FIRST_SHORT, FIRST_LONG, "stop after the first optimal programs", " COUNT");
     print(OUTPUT_EXPR_SHORT, OUTPUT_EXPR_LONG, "print results as expression");
     print(OUTPUT_PROGRAM_SHORT, OUTPUT_PROGRAM_LONG, "print results as program");
+    print(OUTPUT_BINARY_SHORT, OUTPUT_BINARY_LONG, "print results in compact binary format");
+    print(COUNT_SHORT, COUNT_LONG, "only count all optimal programs and their depths");
+    print(UNIQUE_SHORT, UNIQUE_LONG, "drop programs which are isomorphic to earlier ones");
+    print(OUTPUT_NETLIST_SHORT, OUTPUT_NETLIST_LONG, "write netlist (.blif, .aag, .aig)", " FILE");
+    print(EMIT_SHORT, EMIT_LONG, "print an optimal program as C++ header", " cpp[:NAME]");
+
+    out << "\nSearch flags:\n";
+    print(PORTFOLIO_SHORT, PORTFOLIO_LONG, "race multiple search engines, report the winner");
+    print(HEURISTIC_SHORT, HEURISTIC_LONG, "quickly find a good, not always optimal program");
+    print(ANYTIME_SHORT, ANYTIME_LONG, "print ever shorter programs, from the input expression");
+    print(TIMEOUT_SHORT, TIMEOUT_LONG, "stop searching after some time", " MILLIS");
+    print(NODE_BUDGET_SHORT, NODE_BUDGET_LONG, "stop searching after visiting some nodes", " NODES");
+    print(STATS_SHORT, STATS_LONG, "print search statistics (text, json)", " FORMAT");
+    print(TRACE_SHORT, TRACE_LONG, "write a timeline in Chrome trace format", " FILE");
+    print(DISABLE_RULES_SHORT, DISABLE_RULES_LONG, "ignore pruning rules, e.g. 5,duplicate", " RULES");
+    print(ADAPTIVE_RULES_SHORT, ADAPTIVE_RULES_LONG, "reorder pruning rules by measured benefit");
+    print(MOVE_ORDERING_SHORT, MOVE_ORDERING_LONG, "try candidates most similar to the table first");
+
+    out << "\nOptimization flags:\n";
+    print(RESYNTHESIZE_SHORT, RESYNTHESIZE_LONG, "replace small cuts with optimal programs");
+    print(CUT_SIZE_SHORT, CUT_SIZE_LONG, "maximum number of cut inputs (default 4)", " SIZE");
+
+    out << "\nServer options:\n";
+    print(SERVE_SHORT, SERVE_LONG, "answer newline-delimited queries on a socket", " SOCKET");
+    print(QUERY_SHORT, QUERY_LONG, "send queries from stdin to a server", " SOCKET");
 
     out << "\nAlternative output flags (for input expressions):\n";
     print(TOKENIZE_SHORT, TOKENIZE_LONG, "tokenize expression and print");
@@ -178,31 +492,38 @@ constexpr std::optional<SymbolOrder> order_parse(const std::string_view str) noe
     return EXIT_SUCCESS;
 }
 
-[[nodiscard]] int run_tokenize(const LaunchOptions &options)
+/// Tokenizes the expression from the command line or from a file, where "-" stands for stdin.
+[[nodiscard]] std::optional<TokenList> read_expression(const LaunchOptions &options)
 {
-    if (options.expression_str.empty()) {
-        std::cout << "Tokenize option set but no expression to tokenize was given\n";
-        return EXIT_FAILURE;
+    if (options.expression_path.empty()) {
+        return value_or_print_error(tokenize(options.expression_str));
     }
-    std::vector<Token> tokens = tokenize(options.expression_str);
-    for (auto token : tokens) {
+    if (options.expression_path == "-") {
+        return value_or_print_error(tokenize(std::cin));
+    }
+    std::ifstream in{options.expression_path, std::ios::binary};
+    if (not in) {
+        std::cout << "Failed to open \"" << options.expression_path << "\"\n";
+        return std::nullopt;
+    }
+    return value_or_print_error(tokenize(in));
+}
+
+[[nodiscard]] int run_tokenize(const TokenList &tokens)
+{
+    for (const Token &token : tokens.tokens) {
         std::cout << token << '\n';
     }
     return EXIT_SUCCESS;
 }
 
-[[nodiscard]] int run_polish(const LaunchOptions &options)
+[[nodiscard]] int run_polish(const TokenList &tokens)
 {
-    if (options.expression_str.empty()) {
-        std::cout << "Reverse polish output option set but no expression was given\n";
-        return EXIT_FAILURE;
-    }
-    std::vector<Token> tokens = tokenize(options.expression_str);
-    std::vector<Token> polish;
-    if (not to_reverse_polish_notation(polish, tokens)) {
+    const std::optional<std::vector<Token>> polish = value_or_print_error(to_reverse_polish_notation(tokens.tokens));
+    if (not polish.has_value()) {
         return EXIT_FAILURE;
     }
-    for (const auto &token : polish) {
+    for (const auto &token : *polish) {
         std::cout << token.value << ' ';
     }
     std::cout << '\n';
@@ -257,97 +578,319 @@ void output_table_short(std::ostream &out, const std::size_t variables, const st
     return EXIT_SUCCESS;
 }
 
-struct PrintingProgramConsumer : public ProgramConsumer {
-    Program program;
-    LaunchOptions options;
-    bool first = true;
+[[nodiscard]] OutputFormat output_format_of(const LaunchOptions &options) noexcept
+{
+    if (options.is_output_binary) {
+        return OutputFormat::BINARY;
+    }
+    if (options.is_output_program) {
+        return options.is_output_expr ? OutputFormat::EXPRESSION_AND_PROGRAM : OutputFormat::PROGRAM;
+    }
+    return OutputFormat::EXPRESSION;
+}
 
-    [[nodiscard]] PrintingProgramConsumer(const std::size_t variables,
-                                          LaunchOptions options,
-                                          Program *const original_program = nullptr) noexcept
-        : program{variables}, options{std::move(options)}
-    {
-        if (original_program != nullptr) {
-            program.symbols = original_program->symbols;
-        }
+/// Tells if the search stopped at one of its limits, and what it proved until then.
+void print_stopped_search(const SearchResult &result)
+{
+    if (result.status == SearchStatus::STOPPED) {
+        std::cerr << "Search stopped at length " << result.length << " after " << result.nodes
+                  << " nodes (lower bound: " << result.lower_bound << ")\n";
     }
+    else if (not result.complete) {
+        std::cerr << "Search stopped at length " << result.length << " after " << result.nodes
+                  << " nodes, before all optimal programs were found\n";
+    }
+}
 
-    void operator()(const Instruction *ins, const std::size_t count) final
-    {
-        program.clear();
-        for (std::size_t i = 0; i < count; ++i) {
-            program.push(ins[i]);
+/// Searches programs and writes them in the background.
+/// All programs are written before the search summary is printed, so that both appear in order on a terminal.
+void find_programs(AsyncProgramWriter &writer,
+                   const TruthTable table,
+                   const std::size_t variables,
+                   const LaunchOptions &options,
+                   const Program *const seed = nullptr)
+{
+    ConcurrentHashSet seen_programs;
+    DeduplicatingConsumer unique{writer, seen_programs};
+    ProgramConsumer &consumer = options.is_unique ? static_cast<ProgramConsumer &>(unique) : writer;
+
+    if (options.is_anytime) {
+        const AnytimeResult result =
+            find_programs_anytime(consumer, table, InstructionSet::C, variables, seed, options.limits);
+        writer.finish();
+        std::cerr << "Anytime search: best length " << result.best_length;
+        if (result.is_optimal) {
+            std::cerr << " (optimal)\n";
         }
-
-        if (not first && options.is_output_program) {
-            std::cout << '\n';
+        else {
+            std::cerr << " (stopped, lower bound: " << result.lower_bound << ")\n";
         }
-        first = false;
-
-        if (options.is_output_expr || (not options.is_output_expr && not options.is_output_program)) {
-            print_program_as_expression(std::cout, program);
+        return;
+    }
+    if (options.first.has_value()) {
+        // the enumerator only searches as far as the programs which are taken
+        ProgramEnumerator enumerator{table, variables, options.limits};
+        for (std::uint64_t i = 0; i < *options.first && enumerator.next(); ++i) {
+            consumer(enumerator.data(), enumerator.size());
+        }
+        writer.finish();
+        const SearchResult result = enumerator.result();
+        print_stopped_search(result);
+        if (options.is_unique) {
+            std::cerr << "Dropped " << unique.dropped() << " isomorphic programs\n";
         }
-        if (options.is_output_program) {
-            std::cout << program;
+        return;
+    }
+    if (options.is_heuristic) {
+        const HeuristicResult result = find_heuristic_program(consumer, table, variables);
+        writer.finish();
+        std::cerr << "Heuristic program length: " << result.length << " (lower bound: " << result.lower_bound
+                  << ")\n";
+        return;
+    }
+    const TraceScope trace{"find programs"};
+    if (not options.is_portfolio) {
+        SearchStats stats;
+        const bool is_stats = options.stats_format != StatsFormat::NONE;
+        PruningPipeline pipeline{options.is_adaptive_rules};
+        for (const PushRule rule : options.disabled_rules) {
+            pipeline.set_enabled(rule, false);
         }
+        const bool is_pipeline = options.is_adaptive_rules || not options.disabled_rules.empty();
+        const MoveOrdering ordering;
+        SearchOptions search;
+        search.stats = is_stats ? &stats : nullptr;
+        search.pipeline = is_pipeline ? &pipeline : nullptr;
+        search.ordering = options.is_move_ordering ? &ordering : nullptr;
+        const SearchResult result = find_equivalent_programs(
+            consumer, table, InstructionSet::C, variables, options.is_greedy, options.limits, search);
+        writer.finish();
+        if (options.stats_format == StatsFormat::TEXT) {
+            print_stats(std::cerr, stats);
+        }
+        else if (options.stats_format == StatsFormat::JSON) {
+            print_stats_json(std::cerr, stats);
+        }
+        if (options.is_adaptive_rules) {
+            std::cerr << "Pruning rule order:";
+            for (const PushRule rule : pipeline) {
+                std::cerr << ' ' << push_rule_label(rule);
+            }
+            std::cerr << '\n';
+        }
+        print_stopped_search(result);
+        if (options.is_unique) {
+            std::cerr << "Dropped " << unique.dropped() << " isomorphic programs\n";
+        }
+        return;
+    }
 
-        program.clear();
+    const PortfolioResult result = find_equivalent_programs_portfolio(
+        consumer, table, InstructionSet::C, variables, options.is_greedy, options.limits);
+    writer.finish();
+    if (result.found) {
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(result.elapsed).count();
+        std::cerr << "Portfolio winner: " << engine_label(result.winner) << " (" << micros << "us)"
+                  << (result.complete ? "\n" : ", stopped before all optimal programs were found\n");
     }
-};
+    else {
+        std::cerr << "Portfolio search stopped without a proven optimal program\n";
+    }
+}
+
+/// Counts all optimal programs without printing any of them.
+[[nodiscard]] int run_count(const TruthTable table, const std::size_t variables, const LaunchOptions &options)
+{
+    const ProgramCount count = count_equivalent_programs(table, InstructionSet::C, variables, options.limits);
+    if (count.total == 0) {
+        std::cout << "No program found (stopped)\n";
+        return EXIT_SUCCESS;
+    }
+    std::cout << "Programs of length " << count.length << ": " << count.total
+              << (count.complete ? "\n" : " (stopped, incomplete)\n");
+    for (std::size_t depth = 0; depth < ProgramCount::max_depth; ++depth) {
+        if (count.depths[depth] != 0) {
+            std::cout << "    depth " << depth << ": " << count.depths[depth] << '\n';
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/// Finds one optimal program and prints it as a header of C++ functions.
+[[nodiscard]] int run_emit(const TruthTable table, Program prototype, const LaunchOptions &options)
+{
+    ProgramEnumerator enumerator{table, prototype.variables, options.limits};
+    if (not enumerator.next()) {
+        std::cout << "No program found (stopped)\n";
+        return EXIT_FAILURE;
+    }
+    prototype.clear();
+    for (std::size_t i = 0; i < enumerator.size(); ++i) {
+        prototype.push(enumerator.data()[i]);
+    }
+    emit_cpp(std::cout, prototype, options.emit_name);
+    return EXIT_SUCCESS;
+}
+
+void print_resynthesis_stats(std::ostream &out, const ResynthesisStats &stats)
+{
+    out << "Resynthesis: " << stats.initial_gates << " -> " << stats.final_gates << " gates in " << stats.passes
+        << " passes (" << stats.replacements << " replacements, " << stats.cache_hits << " cache hits, "
+        << stats.cache_misses << " cache misses)\n";
+}
+
+[[nodiscard]] bool write_netlist_file(const std::string &path, const Netlist &netlist)
+{
+    std::ofstream out{path, std::ios::binary};
+    if (not out) {
+        std::cout << "Failed to open \"" << path << "\" for writing\n";
+        return false;
+    }
+    write_netlist(out, netlist, *netlist_format_of_path(path));
+    return true;
+}
+
+void optimize_netlist(Netlist &netlist, const LaunchOptions &options)
+{
+    ResynthesisOptions resynthesis_options;
+    resynthesis_options.cut_size = options.cut_size;
+    resynthesis_options.cut_limits.deadline = options.limits.deadline;
+
+    ResynthesisCache cache;
+    print_resynthesis_stats(std::cerr, resynthesize(netlist, cache, resynthesis_options));
+}
+
+[[nodiscard]] int run_with_netlist(const LaunchOptions &options)
+{
+    std::ifstream in{options.input_path, std::ios::binary};
+    if (not in) {
+        std::cout << "Failed to open \"" << options.input_path << "\"\n";
+        return EXIT_FAILURE;
+    }
+    std::optional<Netlist> netlist =
+        value_or_print_error(read_netlist(in, *netlist_format_of_path(options.input_path)));
+    if (not netlist.has_value()) {
+        return EXIT_FAILURE;
+    }
+
+    if (options.is_resynthesize) {
+        optimize_netlist(*netlist, options);
+    }
+    if (not options.output_path.empty()) {
+        return write_netlist_file(options.output_path, *netlist) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    std::cout << "Netlist: " << netlist->inputs << " inputs, " << netlist->gate_count() << " gates, "
+              << netlist->outputs.size() << " outputs\n";
+    return EXIT_SUCCESS;
+}
 
 [[nodiscard]] int run_with_expression(const LaunchOptions &options)
 {
+    const std::optional<TokenList> tokens = read_expression(options);
+    if (not tokens.has_value()) {
+        return EXIT_FAILURE;
+    }
     if (options.is_tokenize) {
-        return run_tokenize(options);
+        return run_tokenize(*tokens);
     }
     if (options.is_polish) {
-        return run_polish(options);
+        return run_polish(*tokens);
     }
-    if (options.expression_str.empty()) {
-        std::cout << "Compile option set but no expression was given\n";
+
+    std::optional<Netlist> compiled_netlist = value_or_print_error(compile_netlist(*tokens, options.symbol_order));
+    if (not compiled_netlist.has_value()) {
         return EXIT_FAILURE;
     }
+    Netlist &netlist = *compiled_netlist;
+    if (options.is_resynthesize) {
+        optimize_netlist(netlist, options);
+    }
+    if (not options.output_path.empty()) {
+        return write_netlist_file(options.output_path, netlist) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-    const std::vector<Token> tokens = tokenize(options.expression_str);
-    Program program = compile(tokens, options.symbol_order);
-
-    if (options.is_compile) {
-        std::cout << program;
+    // small expressions are printed and searched as programs, anything else can only be printed as a netlist
+    std::optional<Program> compiled = program_from_netlist(netlist);
+    if (options.is_compile || options.is_resynthesize) {
+        if (compiled.has_value()) {
+            std::cout << *compiled;
+        }
+        else {
+            std::cout << netlist;
+        }
         return EXIT_SUCCESS;
     }
+    if (not compiled.has_value()) {
+        std::cout << "Expression has " << netlist.inputs << " variables and " << netlist.gate_count()
+                  << " instructions, but searching is limited to " << VARIABLE_COUNT << " variables and "
+                  << Program::instruction_count << " instructions\n";
+        return EXIT_FAILURE;
+    }
+    const Program &program = *compiled;
 
     const TruthTable table = program.compute_truth_table();
     if (options.is_build_table) {
         return run_output_table(program, table.t);
     }
 
-    PrintingProgramConsumer consumer{program.variables, options, &program};
+    if (options.is_count) {
+        return run_count(table, program.variables, options);
+    }
+    if (not options.emit_name.empty()) {
+        return run_emit(table, program, options);
+    }
+    AsyncProgramWriter consumer{std::cout, output_format_of(options), program};
 
-    find_equivalent_programs(consumer, table, InstructionSet::C, program.variables, options.is_greedy);
+    find_programs(consumer, table, program.variables, options, &program);
     return EXIT_SUCCESS;
 }
 
 [[nodiscard]] int run_with_truth_table(const LaunchOptions &options)
 {
     const std::size_t variables = log2floor(options.table_variables_len);
-    PrintingProgramConsumer consumer{variables, options};
+    if (options.is_count) {
+        return run_count(options.table, variables, options);
+    }
+    if (not options.emit_name.empty()) {
+        return run_emit(options.table, Program{variables}, options);
+    }
+    AsyncProgramWriter consumer{std::cout, output_format_of(options), Program{variables}};
 
-    find_equivalent_programs(consumer, options.table, InstructionSet::C, variables, options.is_greedy);
+    find_programs(consumer, options.table, variables, options);
     return EXIT_SUCCESS;
 }
 
+[[nodiscard]] int run_server(const LaunchOptions &options)
+{
+    ServerOptions server_options;
+    server_options.socket_path = options.serve_path;
+    server_options.query_timeout = options.timeout.value_or(server_options.query_timeout);
+    server_options.query_node_budget = options.limits.node_budget;
+    return serve(server_options);
+}
+
 [[nodiscard]] int run(const LaunchOptions &options)
 {
     if (options.is_help) {
         return run_help(std::cout);
     }
-    const bool has_expression = not options.expression_str.empty();
+    if (not options.serve_path.empty()) {
+        return run_server(options);
+    }
+    if (not options.query_path.empty()) {
+        return query_server(options.query_path, std::cin, std::cout);
+    }
+    const bool has_expression = not options.expression_str.empty() || not options.expression_path.empty();
     const bool has_table = options.table_variables_len != 0;
+    const bool has_netlist = not options.input_path.empty();
 
-    if (has_expression && has_table) {
-        std::cout << "Conflicting inputs: both truth table and expression provided\n";
+    if (has_expression + has_table + has_netlist > 1) {
+        std::cout << "Conflicting inputs: more than one of truth table, expression, and netlist provided\n";
         return EXIT_FAILURE;
     }
+    if (has_netlist) {
+        return run_with_netlist(options);
+    }
     if (has_expression) {
         return run_with_expression(options);
     }
@@ -359,6 +902,17 @@ struct PrintingProgramConsumer : public ProgramConsumer {
     return EXIT_FAILURE;
 }
 
+[[nodiscard]] bool write_trace_file(const std::string &path)
+{
+    std::ofstream out{path, std::ios::binary};
+    if (not out) {
+        std::cout << "Failed to open \"" << path << "\" for writing\n";
+        return false;
+    }
+    write_trace(out);
+    return true;
+}
+
 [[nodiscard, maybe_unused]] int run_exhaustive(const unsigned variables)
 {
     for (std::size_t t = 0; t < std::uint64_t{1} << (1 << variables); ++t) {
@@ -408,5 +962,11 @@ int main(int argc, char **argv)
         return run_help(std::cout);
     }
     LaunchOptions options = parse_program_args(argc, argv);
-    return run(options);
+    if (options.trace_path.empty()) {
+        return run(options);
+    }
+    start_tracing();
+    set_trace_thread_name("main");
+    const int result = run(options);
+    return write_trace_file(options.trace_path) ? result : EXIT_FAILURE;
 }
@@ -0,0 +1,116 @@
+#include "netlist.hpp"
+
+#include <ostream>
+
+Netlist netlist_from_program(const Program &program)
+{
+    Netlist netlist;
+    netlist.inputs = static_cast<std::uint32_t>(program.variables);
+    netlist.reserve(program.size());
+
+    const auto convert = [&netlist](const unsigned operand) {
+        return operand < VARIABLE_COUNT ? operand : static_cast<std::uint32_t>(netlist.inputs + operand - VARIABLE_COUNT);
+    };
+    for (std::size_t i = 0; i < program.size(); ++i) {
+        const Instruction ins = program[i];
+        netlist.push(static_cast<Op>(ins.op), convert(ins.a), convert(ins.b));
+    }
+    if (not program.empty()) {
+        netlist.outputs.push_back(netlist.operand_count() - 1);
+    }
+    for (std::size_t i = 0; i < program.variables; ++i) {
+        netlist.input_names.push(program.symbol(i, false));
+    }
+    return netlist;
+}
+
+std::optional<Program> program_from_netlist(const Netlist &netlist)
+{
+    if (netlist.inputs > VARIABLE_COUNT || netlist.gate_count() > Program::instruction_count ||
+        netlist.outputs.size() != 1) {
+        return std::nullopt;
+    }
+
+    Program program{netlist.inputs};
+    for (std::size_t i = 0; i < netlist.input_names.size(); ++i) {
+        program.symbols[i] = netlist.input_names[i];
+    }
+    const auto convert = [&netlist](const std::uint32_t operand) {
+        return netlist.is_input(operand) ? operand : operand - netlist.inputs + VARIABLE_COUNT;
+    };
+    for (std::uint32_t i = netlist.inputs; i < netlist.operand_count(); ++i) {
+        const Gate gate = netlist.gate(i);
+        program.push(static_cast<Op>(gate.op), convert(gate.a), convert(gate.b));
+    }
+    // a program's result is its last instruction, which the output may not be
+    const std::uint32_t output = netlist.outputs.front();
+    if (netlist.is_input(output) || output + 1 != netlist.operand_count()) {
+        if (program.size() == Program::instruction_count) {
+            return std::nullopt;
+        }
+        program.push(Op::A, convert(output), 0);
+    }
+    return program;
+}
+
+Netlist remove_dead_gates(const Netlist &netlist)
+{
+    std::vector<bool> live(netlist.operand_count());
+    for (const std::uint32_t output : netlist.outputs) {
+        live[output] = true;
+    }
+    for (std::uint32_t i = netlist.operand_count(); i-- > netlist.inputs;) {
+        if (not live[i]) {
+            continue;
+        }
+        const Gate gate = netlist.gate(i);
+        const Op op = static_cast<Op>(gate.op);
+        live[gate.a] = live[gate.a] || op_uses_a(op);
+        live[gate.b] = live[gate.b] || op_uses_b(op);
+    }
+
+    Netlist result;
+    result.inputs = netlist.inputs;
+    result.input_names = netlist.input_names;
+    result.output_names = netlist.output_names;
+    std::vector<std::uint32_t> renamed(netlist.operand_count());
+    for (std::uint32_t i = 0; i < netlist.inputs; ++i) {
+        renamed[i] = i;
+    }
+    for (std::uint32_t i = netlist.inputs; i < netlist.operand_count(); ++i) {
+        if (live[i]) {
+            const Gate gate = netlist.gate(i);
+            renamed[i] = result.push(static_cast<Op>(gate.op), renamed[gate.a], renamed[gate.b]);
+        }
+    }
+    result.outputs.reserve(netlist.outputs.size());
+    for (const std::uint32_t output : netlist.outputs) {
+        result.outputs.push_back(renamed[output]);
+    }
+    return result;
+}
+
+std::ostream &operator<<(std::ostream &out, const Netlist &netlist)
+{
+    const auto name = [&netlist](const std::uint32_t operand) {
+        if (not netlist.is_input(operand)) {
+            return '%' + std::to_string(operand - netlist.inputs);
+        }
+        if (netlist.input_names.empty()) {
+            return '@' + std::to_string(operand);
+        }
+        return '@' + std::string{netlist.input_names[operand]};
+    };
+
+    for (std::uint32_t i = netlist.inputs; i < netlist.operand_count(); ++i) {
+        const Gate gate = netlist.gate(i);
+        out << name(i) << " = ";
+        print_operation(out, static_cast<Op>(gate.op), name(gate.a), name(gate.b)) << '\n';
+    }
+    for (std::size_t i = 0; i < netlist.outputs.size(); ++i) {
+        if (not netlist.output_names.empty()) {
+            out << netlist.output_names[i] << " = " << name(netlist.outputs[i]) << '\n';
+        }
+    }
+    return out;
+}
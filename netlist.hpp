@@ -0,0 +1,124 @@
+#ifndef NETLIST_HPP
+#define NETLIST_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "program.hpp"
+
+/// A list of names which are all stored in a single buffer.
+/// Netlists can have millions of named signals, which shouldn't require millions of allocations.
+class NameTable {
+private:
+    std::string chars;
+    std::vector<std::size_t> ends;
+
+public:
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return ends.size();
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return ends.empty();
+    }
+
+    [[nodiscard]] std::string_view operator[](const std::size_t i) const noexcept
+    {
+        const std::size_t begin = i == 0 ? 0 : ends[i - 1];
+        return std::string_view{chars}.substr(begin, ends[i] - begin);
+    }
+
+    void push(const std::string_view name)
+    {
+        chars += name;
+        ends.push_back(chars.size());
+    }
+
+    void clear() noexcept
+    {
+        chars.clear();
+        ends.clear();
+    }
+};
+
+/// a two-input gate of a netlist
+struct Gate {
+    /// the truth table of the operation
+    std::uint8_t op;
+    /// the operand index of the first operand
+    std::uint32_t a;
+    /// the operand index of the second operand
+    std::uint32_t b;
+};
+
+/// A directed acyclic graph of gates without any limit on the number of inputs, gates or outputs.
+/// Operand indices below the number of inputs refer to the inputs, all others to the gate at (index - inputs).
+/// Gates only ever refer to inputs or earlier gates, so the gates are always in topological order.
+/// The names of inputs and outputs are optional, they are either empty or have one name per input or output.
+/// Gates are stored as a struct of arrays, which keeps passes over millions of gates cache-friendly.
+struct Netlist {
+    std::uint32_t inputs = 0;
+    /// the operation of each gate
+    std::vector<std::uint8_t> ops;
+    /// the first operand of each gate
+    std::vector<std::uint32_t> operands_a;
+    /// the second operand of each gate
+    std::vector<std::uint32_t> operands_b;
+    std::vector<std::uint32_t> outputs;
+    NameTable input_names;
+    NameTable output_names;
+
+    [[nodiscard]] std::uint32_t gate_count() const noexcept
+    {
+        return static_cast<std::uint32_t>(ops.size());
+    }
+
+    [[nodiscard]] std::uint32_t operand_count() const noexcept
+    {
+        return inputs + gate_count();
+    }
+
+    [[nodiscard]] bool is_input(const std::uint32_t operand) const noexcept
+    {
+        return operand < inputs;
+    }
+
+    [[nodiscard]] Gate gate(const std::uint32_t operand) const noexcept
+    {
+        const std::size_t i = operand - inputs;
+        return {ops[i], operands_a[i], operands_b[i]};
+    }
+
+    void reserve(const std::size_t gates)
+    {
+        ops.reserve(gates);
+        operands_a.reserve(gates);
+        operands_b.reserve(gates);
+    }
+
+    std::uint32_t push(const Op op, const std::uint32_t a, const std::uint32_t b = 0)
+    {
+        ops.push_back(static_cast<std::uint8_t>(op));
+        operands_a.push_back(a);
+        operands_b.push_back(b);
+        return operand_count() - 1;
+    }
+};
+
+std::ostream &operator<<(std::ostream &out, const Netlist &netlist);
+
+/// Converts a program into a netlist with a single output, the result of the program.
+[[nodiscard]] Netlist netlist_from_program(const Program &program);
+
+/// Converts a netlist with a single output into a program, if it fits into one.
+[[nodiscard]] std::optional<Program> program_from_netlist(const Netlist &netlist);
+
+/// Returns an equivalent netlist without any gates that no output depends on.
+[[nodiscard]] Netlist remove_dead_gates(const Netlist &netlist);
+
+#endif  // NETLIST_HPP
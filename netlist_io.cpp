@@ -0,0 +1,1072 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "netlist_io.hpp"
+#include "util.hpp"
+
+namespace {
+
+constexpr std::uint32_t NONE = ~std::uint32_t{0};
+
+/// Reads a stream in large chunks and hands out lines as views into its buffer.
+/// A line stays valid until the next read.
+class LineReader {
+private:
+    static constexpr std::size_t CHUNK_SIZE = std::size_t{1} << 20;
+
+    std::istream &in;
+    std::vector<char> buffer;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    bool eof = false;
+
+public:
+    std::size_t line_number = 0;
+
+    explicit LineReader(std::istream &in) : in{in}, buffer(CHUNK_SIZE) {}
+
+    bool next_line(std::string_view &line)
+    {
+        // the number of bytes after begin which are known not to contain a line break
+        std::size_t checked = 0;
+        while (true) {
+            const char *const data = buffer.data();
+            if (const void *newline = std::memchr(data + begin + checked, '\n', end - begin - checked)) {
+                const auto pos = static_cast<std::size_t>(static_cast<const char *>(newline) - data);
+                line = make_line(begin, pos);
+                begin = pos + 1;
+                return true;
+            }
+            if (eof) {
+                if (begin == end) {
+                    return false;
+                }
+                line = make_line(begin, end);
+                begin = end;
+                return true;
+            }
+            checked = end - begin;
+            refill();
+        }
+    }
+
+    /// Reads a single byte, or returns -1 at the end of the stream.
+    int next_byte()
+    {
+        if (begin == end) {
+            if (eof) {
+                return -1;
+            }
+            refill();
+            if (begin == end) {
+                return -1;
+            }
+        }
+        return static_cast<unsigned char>(buffer[begin++]);
+    }
+
+private:
+    std::string_view make_line(const std::size_t from, std::size_t to) noexcept
+    {
+        ++line_number;
+        if (to > from && buffer[to - 1] == '\r') {
+            --to;
+        }
+        return {buffer.data() + from, to - from};
+    }
+
+    void refill()
+    {
+        // keep the unread rest at the front, which only grows the buffer if a single line doesn't fit into it
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+        if (end == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+        in.read(buffer.data() + end, static_cast<std::streamsize>(buffer.size() - end));
+        const auto count = static_cast<std::size_t>(in.gcount());
+        end += count;
+        eof = not in || count == 0;
+    }
+};
+
+/// stores strings in large blocks which never move, so that views of them stay valid
+class StringArena {
+private:
+    static constexpr std::size_t BLOCK_SIZE = std::size_t{1} << 16;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t used = 0;
+    std::size_t capacity = 0;
+
+public:
+    std::string_view store(const std::string_view str)
+    {
+        if (str.size() > capacity - used) {
+            capacity = std::max(BLOCK_SIZE, str.size());
+            blocks.push_back(std::make_unique<char[]>(capacity));
+            used = 0;
+        }
+        char *const result = blocks.back().get() + used;
+        std::memcpy(result, str.data(), str.size());
+        used += str.size();
+        return {result, str.size()};
+    }
+};
+
+/// buffers output so that writing millions of small tokens doesn't turn into millions of stream insertions
+class OutputBuffer {
+private:
+    static constexpr std::size_t FLUSH_SIZE = std::size_t{1} << 20;
+
+    std::ostream &out;
+    std::string buffer;
+
+public:
+    explicit OutputBuffer(std::ostream &out) : out{out}
+    {
+        buffer.reserve(FLUSH_SIZE * 2);
+    }
+
+    ~OutputBuffer()
+    {
+        flush();
+    }
+
+    void write(const std::string_view str)
+    {
+        buffer += str;
+        if (buffer.size() >= FLUSH_SIZE) {
+            flush();
+        }
+    }
+
+    void write_byte(const char c)
+    {
+        buffer.push_back(c);
+    }
+
+    void write_number(const std::uint64_t x)
+    {
+        char digits[20];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), x);
+        buffer.append(digits, result.ptr);
+    }
+
+    void flush()
+    {
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+};
+
+[[nodiscard]] std::string_view next_word(std::string_view &rest) noexcept
+{
+    constexpr std::string_view whitespace = " \t";
+    const std::size_t begin = std::min(rest.find_first_not_of(whitespace), rest.size());
+    const std::size_t end = std::min(rest.find_first_of(whitespace, begin), rest.size());
+    const std::string_view result = rest.substr(begin, end - begin);
+    rest.remove_prefix(end);
+    return result;
+}
+
+[[nodiscard]] bool parse_number(const std::string_view str, std::uint32_t &result) noexcept
+{
+    const auto [end, error] = std::from_chars(str.data(), str.data() + str.size(), result);
+    return error == std::errc{} && end == str.data() + str.size() && not str.empty();
+}
+
+/// Returns the operation whose result is f(a, b).
+template <typename F>
+[[nodiscard]] Op op_of(const F &f) noexcept
+{
+    unsigned bits = 0;
+    for (unsigned a = 0; a < 2; ++a) {
+        for (unsigned b = 0; b < 2; ++b) {
+            bits |= unsigned{f(a != 0, b != 0)} << (a << 1 | b);
+        }
+    }
+    return static_cast<Op>(bits);
+}
+
+/// an operand of a netlist which may be inverted
+struct Literal {
+    std::uint32_t operand;
+    bool positive;
+};
+
+[[nodiscard]] Literal push_and(Netlist &netlist, const Literal x, const Literal y)
+{
+    const Op op = op_of([&](const bool a, const bool b) {
+        return a == x.positive && b == y.positive;
+    });
+    return {netlist.push(op, x.operand, y.operand), true};
+}
+
+[[nodiscard]] Literal push_or(Netlist &netlist, const Literal x, const Literal y)
+{
+    const Op op = op_of([&](const bool a, const bool b) {
+        return a == x.positive || b == y.positive;
+    });
+    return {netlist.push(op, x.operand, y.operand), true};
+}
+
+[[nodiscard]] std::uint32_t push_literal(Netlist &netlist, const Literal x)
+{
+    return x.positive ? x.operand : netlist.push(Op::NOT_A, x.operand, x.operand);
+}
+
+/// Resolves the operands of signals in dependency order without recursion, because netlists can be very deep.
+class SignalResolver {
+private:
+    std::vector<std::uint32_t> stack;
+    std::vector<bool> visiting;
+
+public:
+    explicit SignalResolver(const std::size_t signal_count) : visiting(signal_count) {}
+
+    /// define(signal) has to create the operand of a signal whose dependencies are all resolved,
+    /// dependencies(signal, callback) has to call the callback for each dependency of a signal
+    /// and return false if the signal is undefined.
+    template <typename Define, typename Dependencies, typename OnError>
+    bool resolve(std::vector<std::uint32_t> &operand_of,
+                 const std::uint32_t signal,
+                 Define define,
+                 Dependencies dependencies,
+                 OnError error)
+    {
+        stack.clear();
+        stack.push_back(signal);
+        while (not stack.empty()) {
+            const std::uint32_t top = stack.back();
+            if (operand_of[top] != NONE) {
+                stack.pop_back();
+                continue;
+            }
+            if (visiting[top]) {
+                define(top);
+                stack.pop_back();
+                continue;
+            }
+            visiting[top] = true;
+            bool cycle = false;
+            const bool defined = dependencies(top, [&](const std::uint32_t dependency) {
+                if (operand_of[dependency] == NONE) {
+                    cycle |= visiting[dependency];
+                    stack.push_back(dependency);
+                }
+            });
+            if (not defined) {
+                return error(top, "is never defined");
+            }
+            if (cycle) {
+                return error(top, "is part of a combinational cycle");
+            }
+        }
+        return true;
+    }
+};
+
+class BlifReader {
+private:
+    struct Definition {
+        std::uint32_t first_input;
+        std::uint32_t input_count;
+        std::size_t first_cube;
+        std::uint32_t cube_count;
+        /// true if the cubes describe where the signal is false
+        bool complemented;
+    };
+
+    LineReader reader;
+    StringArena arena;
+    std::unordered_map<std::string_view, std::uint32_t> signals;
+    std::vector<std::string_view> signal_names;
+
+    std::vector<std::uint32_t> definition_of;
+    std::vector<Definition> definitions;
+    std::vector<std::uint32_t> definition_inputs;
+    std::vector<char> cubes;
+    std::vector<std::uint32_t> input_signals;
+    std::vector<std::uint32_t> output_signals;
+
+    std::string joined_line;
+    std::string error_message;
+    Netlist netlist;
+    std::vector<std::uint32_t> operand_of;
+
+public:
+    explicit BlifReader(std::istream &in) : reader{in} {}
+
+    Result<Netlist> read()
+    {
+        if (not parse() || not build()) {
+            return Error{ErrorCode::INVALID_NETLIST, std::move(error_message)};
+        }
+        return std::move(netlist);
+    }
+
+private:
+    bool error(const std::string_view message)
+    {
+        error_message = "BLIF error at line " + std::to_string(reader.line_number) + ": ";
+        error_message += message;
+        return false;
+    }
+
+    bool signal_error(const std::uint32_t signal, const std::string_view message)
+    {
+        error_message = "BLIF error: signal \"";
+        error_message += signal_names[signal];
+        error_message += "\" ";
+        error_message += message;
+        return false;
+    }
+
+    std::uint32_t intern(const std::string_view name)
+    {
+        if (const auto it = signals.find(name); it != signals.end()) {
+            return it->second;
+        }
+        const std::string_view stored = arena.store(name);
+        const auto id = static_cast<std::uint32_t>(signal_names.size());
+        signals.emplace(stored, id);
+        signal_names.push_back(stored);
+        definition_of.push_back(NONE);
+        return id;
+    }
+
+    /// Reads the next non-empty line without comments, joining lines which end in a backslash.
+    bool next_logical_line(std::string_view &result)
+    {
+        joined_line.clear();
+        std::string_view line;
+        while (reader.next_line(line)) {
+            line = line.substr(0, line.find('#'));
+            const bool continued = not line.empty() && line.back() == '\\';
+            if (continued) {
+                line.remove_suffix(1);
+            }
+            if (continued || not joined_line.empty()) {
+                joined_line += line;
+                joined_line += ' ';
+            }
+            if (continued) {
+                continue;
+            }
+            result = joined_line.empty() ? line : std::string_view{joined_line};
+            if (result.find_first_not_of(" \t") != std::string_view::npos) {
+                return true;
+            }
+            joined_line.clear();
+        }
+        result = joined_line;
+        return not joined_line.empty();
+    }
+
+    bool parse()
+    {
+        std::uint32_t current = NONE;
+        std::string_view line;
+        while (next_logical_line(line)) {
+            std::string_view rest = line;
+            const std::string_view word = next_word(rest);
+
+            if (word.front() != '.') {
+                if (current == NONE) {
+                    return error("cover line outside of .names");
+                }
+                if (not parse_cube(definitions[current], word, rest)) {
+                    return false;
+                }
+                continue;
+            }
+
+            current = NONE;
+            if (word == ".inputs" || word == ".outputs") {
+                auto &list = word == ".inputs" ? input_signals : output_signals;
+                for (std::string_view name = next_word(rest); not name.empty(); name = next_word(rest)) {
+                    list.push_back(intern(name));
+                }
+            }
+            else if (word == ".names") {
+                const auto first_input = static_cast<std::uint32_t>(definition_inputs.size());
+                for (std::string_view name = next_word(rest); not name.empty(); name = next_word(rest)) {
+                    definition_inputs.push_back(intern(name));
+                }
+                if (definition_inputs.size() == first_input) {
+                    return error(".names without any signals");
+                }
+                const std::uint32_t output = definition_inputs.back();
+                definition_inputs.pop_back();
+                if (definition_of[output] != NONE) {
+                    return error("signal is defined more than once");
+                }
+                current = definition_of[output] = static_cast<std::uint32_t>(definitions.size());
+                definitions.push_back({first_input,
+                                       static_cast<std::uint32_t>(definition_inputs.size() - first_input),
+                                       cubes.size(),
+                                       0,
+                                       false});
+            }
+            else if (word == ".end") {
+                break;
+            }
+            else if (word == ".latch" || word == ".mlatch" || word == ".subckt" || word == ".gate" ||
+                     word == ".exdc") {
+                return error("only combinational netlists without subcircuits are supported");
+            }
+            // everything else, such as .model or timing information, is irrelevant for the logic
+        }
+        return true;
+    }
+
+    bool parse_cube(Definition &definition, const std::string_view first, std::string_view rest)
+    {
+        const std::string_view pattern = definition.input_count == 0 ? std::string_view{} : first;
+        const std::string_view value = definition.input_count == 0 ? first : next_word(rest);
+
+        if (pattern.size() != definition.input_count || pattern.find_first_not_of("01-") != std::string_view::npos) {
+            return error("malformed cube");
+        }
+        if (value != "0" && value != "1") {
+            return error("output of cube must be 0 or 1");
+        }
+        const bool complemented = value == "0";
+        if (definition.cube_count != 0 && complemented != definition.complemented) {
+            return error("cover mixes on-set and off-set cubes");
+        }
+        definition.complemented = complemented;
+        cubes.insert(cubes.end(), pattern.begin(), pattern.end());
+        ++definition.cube_count;
+        return true;
+    }
+
+    bool build()
+    {
+        netlist.inputs = static_cast<std::uint32_t>(input_signals.size());
+        operand_of.assign(signal_names.size(), NONE);
+        for (std::uint32_t i = 0; i < input_signals.size(); ++i) {
+            const std::uint32_t signal = input_signals[i];
+            if (operand_of[signal] != NONE || definition_of[signal] != NONE) {
+                return signal_error(signal, "is an input more than once or an input with a definition");
+            }
+            operand_of[signal] = i;
+            netlist.input_names.push(signal_names[signal]);
+        }
+
+        const auto define = [this](const std::uint32_t signal) {
+            operand_of[signal] = build_definition(definitions[definition_of[signal]]);
+        };
+        const auto dependencies = [this](const std::uint32_t signal, auto callback) {
+            if (definition_of[signal] == NONE) {
+                return false;
+            }
+            const Definition &definition = definitions[definition_of[signal]];
+            for (std::uint32_t i = 0; i < definition.input_count; ++i) {
+                callback(definition_inputs[definition.first_input + i]);
+            }
+            return true;
+        };
+        const auto error = [this](const std::uint32_t signal, const std::string_view message) {
+            return signal_error(signal, message);
+        };
+
+        SignalResolver resolver{signal_names.size()};
+        for (const std::uint32_t signal : output_signals) {
+            if (not resolver.resolve(operand_of, signal, define, dependencies, error)) {
+                return false;
+            }
+            netlist.outputs.push_back(operand_of[signal]);
+            netlist.output_names.push(signal_names[signal]);
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool cube_matches(const Definition &definition,
+                                    const std::uint32_t cube,
+                                    const std::uint32_t input,
+                                    const bool value) const noexcept
+    {
+        const char c = cubes[definition.first_cube + std::size_t{cube} * definition.input_count + input];
+        return c == '-' || (c == '1') == value;
+    }
+
+    std::uint32_t build_definition(const Definition &definition)
+    {
+        const auto input = [this, &definition](const std::uint32_t i) {
+            return operand_of[definition_inputs[definition.first_input + i]];
+        };
+
+        // covers of up to two inputs are a single gate, because gates can have any operation
+        if (definition.input_count <= 2) {
+            const Op op = op_of([&](const bool a, const bool b) {
+                bool covered = false;
+                for (std::uint32_t c = 0; c < definition.cube_count; ++c) {
+                    covered |= (definition.input_count < 1 || cube_matches(definition, c, 0, a)) &&
+                               (definition.input_count < 2 || cube_matches(definition, c, 1, b));
+                }
+                return covered != definition.complemented;
+            });
+            const std::uint32_t a = definition.input_count >= 1 ? input(0) : 0;
+            const std::uint32_t b = definition.input_count >= 2 ? input(1) : a;
+            return op == Op::A ? a : op == Op::B ? b : netlist.push(op, a, b);
+        }
+
+        std::optional<Literal> sum;
+        for (std::uint32_t c = 0; c < definition.cube_count; ++c) {
+            std::optional<Literal> product;
+            for (std::uint32_t i = 0; i < definition.input_count; ++i) {
+                const char value = cubes[definition.first_cube + std::size_t{c} * definition.input_count + i];
+                if (value == '-') {
+                    continue;
+                }
+                const Literal literal{input(i), value == '1'};
+                product = product ? push_and(netlist, *product, literal) : literal;
+            }
+            if (not product) {
+                // a cube without literals covers everything
+                return netlist.push(definition.complemented ? Op::FALSE : Op::TRUE, 0, 0);
+            }
+            sum = sum ? push_or(netlist, *sum, *product) : *product;
+        }
+        if (not sum) {
+            return netlist.push(definition.complemented ? Op::TRUE : Op::FALSE, 0, 0);
+        }
+        sum->positive ^= definition.complemented;
+        return push_literal(netlist, *sum);
+    }
+};
+
+class AigerReader {
+private:
+    LineReader reader;
+    bool binary;
+
+    std::uint32_t max_variable = 0;
+    std::vector<std::uint32_t> input_variables;
+    std::vector<std::uint32_t> output_literals;
+    /// the two operand literals of the AND gate of each variable, or NONE for variables without AND gate
+    std::vector<pair<std::uint32_t>> ands;
+
+    std::string error_message;
+    Netlist netlist;
+    std::vector<std::uint32_t> operand_of;
+    std::vector<std::uint32_t> complement_of;
+
+public:
+    AigerReader(std::istream &in, const bool binary) : reader{in}, binary{binary} {}
+
+    Result<Netlist> read()
+    {
+        if (not parse() || not build()) {
+            return Error{ErrorCode::INVALID_NETLIST, std::move(error_message)};
+        }
+        return std::move(netlist);
+    }
+
+private:
+    bool error(const std::string_view message)
+    {
+        error_message = "AIGER error at line " + std::to_string(reader.line_number) + ": ";
+        error_message += message;
+        return false;
+    }
+
+    bool parse_literal_line(std::uint32_t &literal)
+    {
+        std::string_view line;
+        if (not reader.next_line(line)) {
+            return error("unexpected end of file");
+        }
+        if (not parse_number(next_word(line), literal) || literal / 2 > max_variable) {
+            return error("invalid literal");
+        }
+        return true;
+    }
+
+    bool parse_delta(std::uint32_t &delta)
+    {
+        delta = 0;
+        for (unsigned shift = 0; shift < 32; shift += 7) {
+            const int byte = reader.next_byte();
+            if (byte < 0) {
+                return error("unexpected end of file in binary AND gates");
+            }
+            delta |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return error("malformed delta in binary AND gates");
+    }
+
+    bool parse()
+    {
+        std::string_view line;
+        if (not reader.next_line(line)) {
+            return error("empty file");
+        }
+        const std::string_view magic = next_word(line);
+        if (magic != (binary ? "aig" : "aag")) {
+            return error(binary ? "binary AIGER files must start with \"aig\"" : "AIGER files must start with \"aag\"");
+        }
+        std::uint32_t header[5];
+        for (std::uint32_t &field : header) {
+            if (not parse_number(next_word(line), field)) {
+                return error("malformed header");
+            }
+        }
+        for (std::string_view extra = next_word(line); not extra.empty(); extra = next_word(line)) {
+            if (extra != "0") {
+                return error("only combinational AIGs are supported");
+            }
+        }
+        const auto [m, i, l, o, a] = header;
+        if (l != 0) {
+            return error("latches are not supported, only combinational AIGs");
+        }
+        max_variable = m;
+        ands.assign(std::size_t{m} + 1, {NONE, NONE});
+
+        input_variables.resize(i);
+        for (std::uint32_t k = 0; k < i; ++k) {
+            if (binary) {
+                input_variables[k] = k + 1;
+                continue;
+            }
+            std::uint32_t literal;
+            if (not parse_literal_line(literal)) {
+                return false;
+            }
+            if (literal < 2 || literal % 2 != 0) {
+                return error("inputs must be positive literals");
+            }
+            input_variables[k] = literal / 2;
+        }
+
+        output_literals.resize(o);
+        for (std::uint32_t &literal : output_literals) {
+            if (not parse_literal_line(literal)) {
+                return false;
+            }
+        }
+
+        for (std::uint32_t k = 0; k < a; ++k) {
+            std::uint32_t lhs, rhs0, rhs1;
+            if (binary) {
+                std::uint32_t delta0, delta1;
+                lhs = 2 * (i + k + 1);
+                if (not parse_delta(delta0) || not parse_delta(delta1) || delta0 > lhs || delta1 > lhs - delta0) {
+                    return error("malformed binary AND gate");
+                }
+                rhs0 = lhs - delta0;
+                rhs1 = rhs0 - delta1;
+            }
+            else {
+                if (not reader.next_line(line)) {
+                    return error("unexpected end of file");
+                }
+                if (not parse_number(next_word(line), lhs) || not parse_number(next_word(line), rhs0) ||
+                    not parse_number(next_word(line), rhs1)) {
+                    return error("malformed AND gate");
+                }
+            }
+            if (lhs % 2 != 0 || lhs < 2 || lhs / 2 > max_variable || rhs0 / 2 > max_variable ||
+                rhs1 / 2 > max_variable) {
+                return error("invalid literal in AND gate");
+            }
+            ands[lhs / 2] = {rhs0, rhs1};
+        }
+        return parse_symbols();
+    }
+
+    bool parse_symbols()
+    {
+        NameTable names[2];
+        std::vector<std::uint32_t> positions[2];
+
+        std::string_view line;
+        while (reader.next_line(line)) {
+            if (line.empty() || line.front() == 'c') {
+                break;
+            }
+            const bool is_input = line.front() == 'i';
+            if (not is_input && line.front() != 'o') {
+                continue;
+            }
+            const std::size_t space = line.find(' ');
+            std::uint32_t position;
+            if (space == std::string_view::npos || not parse_number(line.substr(1, space - 1), position)) {
+                return error("malformed symbol");
+            }
+            names[is_input].push(line.substr(space + 1));
+            positions[is_input].push_back(position);
+        }
+
+        // symbols are optional, but if there are any, every input or output should have a name
+        const auto apply = [](NameTable &target, const NameTable &source, const std::vector<std::uint32_t> &pos,
+                              const std::size_t count) {
+            if (source.size() != count) {
+                return;
+            }
+            std::vector<std::uint32_t> order(count, NONE);
+            for (std::uint32_t k = 0; k < count; ++k) {
+                if (pos[k] >= count) {
+                    return;
+                }
+                order[pos[k]] = k;
+            }
+            for (const std::uint32_t k : order) {
+                if (k == NONE) {
+                    return;
+                }
+            }
+            for (const std::uint32_t k : order) {
+                target.push(source[k]);
+            }
+        };
+        apply(netlist.input_names, names[true], positions[true], input_variables.size());
+        apply(netlist.output_names, names[false], positions[false], output_literals.size());
+        return true;
+    }
+
+    std::uint32_t constant_false()
+    {
+        if (operand_of[0] == NONE) {
+            operand_of[0] = netlist.push(Op::FALSE, 0, 0);
+        }
+        return operand_of[0];
+    }
+
+    Literal literal(const std::uint32_t lit)
+    {
+        const std::uint32_t variable = lit / 2;
+        return {variable == 0 ? constant_false() : operand_of[variable], lit % 2 == 0};
+    }
+
+    bool build()
+    {
+        netlist.inputs = static_cast<std::uint32_t>(input_variables.size());
+        operand_of.assign(std::size_t{max_variable} + 1, NONE);
+        complement_of.assign(std::size_t{max_variable} + 1, NONE);
+        for (std::uint32_t k = 0; k < input_variables.size(); ++k) {
+            if (operand_of[input_variables[k]] != NONE || ands[input_variables[k]].first != NONE) {
+                return error("variable is an input more than once or an input with an AND gate");
+            }
+            operand_of[input_variables[k]] = k;
+        }
+
+        const auto define = [this](const std::uint32_t variable) {
+            const auto [rhs0, rhs1] = ands[variable];
+            operand_of[variable] = push_and(netlist, literal(rhs0), literal(rhs1)).operand;
+        };
+        const auto dependencies = [this](const std::uint32_t variable, auto callback) {
+            if (variable == 0) {
+                constant_false();
+                return true;
+            }
+            if (ands[variable].first == NONE) {
+                return false;
+            }
+            callback(ands[variable].first / 2);
+            callback(ands[variable].second / 2);
+            return true;
+        };
+        const auto error = [this](const std::uint32_t variable, const std::string_view message) {
+            error_message = "AIGER error: variable " + std::to_string(variable) + ' ';
+            error_message += message;
+            return false;
+        };
+
+        SignalResolver resolver{operand_of.size()};
+        netlist.outputs.reserve(output_literals.size());
+        for (const std::uint32_t lit : output_literals) {
+            const std::uint32_t variable = lit / 2;
+            if (not resolver.resolve(operand_of, variable, define, dependencies, error)) {
+                return false;
+            }
+            if (lit % 2 == 0) {
+                netlist.outputs.push_back(literal(lit).operand);
+                continue;
+            }
+            if (complement_of[variable] == NONE) {
+                complement_of[variable] = push_literal(netlist, literal(lit));
+            }
+            netlist.outputs.push_back(complement_of[variable]);
+        }
+        return true;
+    }
+};
+
+/// Returns the prefix, extended by underscores until no name of the tables is the prefix followed by a number, so
+/// that generated names never collide with the names of the netlist.
+[[nodiscard]] std::string unique_prefix(std::string prefix, const Netlist &netlist)
+{
+    const auto collides = [&prefix](const NameTable &names) {
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            const std::string_view name = names[i];
+            if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+                name.find_first_not_of("0123456789", prefix.size()) == std::string_view::npos) {
+                return true;
+            }
+        }
+        return false;
+    };
+    while (collides(netlist.input_names) || collides(netlist.output_names)) {
+        prefix += '_';
+    }
+    return prefix;
+}
+
+void write_blif(std::ostream &stream, const Netlist &netlist)
+{
+    OutputBuffer out{stream};
+    const std::string gate_prefix = unique_prefix("_n", netlist);
+    const std::string input_prefix = unique_prefix("i", netlist);
+
+    const auto write_signal = [&](const std::uint32_t operand) {
+        if (not netlist.is_input(operand)) {
+            out.write(gate_prefix);
+            out.write_number(operand);
+        }
+        else if (netlist.input_names.empty()) {
+            out.write(input_prefix);
+            out.write_number(operand);
+        }
+        else {
+            out.write(netlist.input_names[operand]);
+        }
+    };
+
+    // an output named like an input is that input in BLIF, so it needs no buffer if it is that input, and a name of
+    // its own otherwise
+    std::unordered_map<std::string_view, std::uint32_t> inputs_by_name;
+    for (std::uint32_t i = 0; i < netlist.input_names.size(); ++i) {
+        inputs_by_name.emplace(netlist.input_names[i], i);
+    }
+    const std::string output_prefix = unique_prefix("o", netlist);
+    std::vector<std::string> output_names(netlist.outputs.size());
+    std::vector<bool> is_buffered(netlist.outputs.size(), true);
+    for (std::size_t i = 0; i < netlist.outputs.size(); ++i) {
+        std::string &name = output_names[i];
+        name = netlist.output_names.empty() ? output_prefix + std::to_string(i) : std::string{netlist.output_names[i]};
+        if (const auto it = inputs_by_name.find(name); it != inputs_by_name.end() && it->second == netlist.outputs[i]) {
+            is_buffered[i] = false;
+            continue;
+        }
+        while (inputs_by_name.count(name) != 0) {
+            name += '_';
+        }
+    }
+
+    out.write(".model boolexpr\n.inputs");
+    for (std::uint32_t i = 0; i < netlist.inputs; ++i) {
+        out.write_byte(' ');
+        write_signal(i);
+    }
+    out.write("\n.outputs");
+    for (std::size_t i = 0; i < netlist.outputs.size(); ++i) {
+        out.write_byte(' ');
+        out.write(output_names[i]);
+    }
+    out.write_byte('\n');
+
+    for (std::uint32_t i = netlist.inputs; i < netlist.operand_count(); ++i) {
+        const Gate gate = netlist.gate(i);
+        const Op op = static_cast<Op>(gate.op);
+        const unsigned bits = gate.op;
+        const bool uses_a = op_uses_a(op);
+        const bool uses_b = op_uses_b(op);
+
+        out.write(".names ");
+        if (uses_a) {
+            write_signal(gate.a);
+            out.write_byte(' ');
+        }
+        if (uses_b) {
+            write_signal(gate.b);
+            out.write_byte(' ');
+        }
+        write_signal(i);
+        out.write_byte('\n');
+
+        for (unsigned row = 0; row < 4; ++row) {
+            const bool a = row >> 1 & 1;
+            const bool b = row & 1;
+            // rows which only differ in an unused operand would be duplicates
+            if ((not uses_a && a) || (not uses_b && b) || not(bits >> row & 1)) {
+                continue;
+            }
+            if (uses_a) {
+                out.write_byte(a ? '1' : '0');
+            }
+            if (uses_b) {
+                out.write_byte(b ? '1' : '0');
+            }
+            out.write(uses_a || uses_b ? " 1\n" : "1\n");
+        }
+    }
+
+    for (std::size_t i = 0; i < netlist.outputs.size(); ++i) {
+        if (not is_buffered[i]) {
+            continue;
+        }
+        out.write(".names ");
+        write_signal(netlist.outputs[i]);
+        out.write_byte(' ');
+        out.write(output_names[i]);
+        out.write("\n1 1\n");
+    }
+    out.write(".end\n");
+}
+
+void write_aiger(std::ostream &stream, const Netlist &netlist, const bool binary)
+{
+    // AIGs only have AND gates and inverters, so every gate turns into up to three AND gates
+    std::vector<pair<std::uint32_t>> ands;
+    std::vector<std::uint32_t> literals(netlist.operand_count());
+    for (std::uint32_t i = 0; i < netlist.inputs; ++i) {
+        literals[i] = 2 * (i + 1);
+    }
+
+    const auto push_and_gate = [&](std::uint32_t x, std::uint32_t y) {
+        swap_if(x, y, x < y);
+        ands.push_back({x, y});
+        return static_cast<std::uint32_t>(2 * (netlist.inputs + ands.size()));
+    };
+
+    for (std::uint32_t i = netlist.inputs; i < netlist.operand_count(); ++i) {
+        const Gate gate = netlist.gate(i);
+        const Op op = static_cast<Op>(gate.op);
+        const unsigned bits = gate.op;
+        const std::uint32_t a = op_uses_a(op) ? literals[gate.a] : 0;
+        const std::uint32_t b = op_uses_b(op) ? literals[gate.b] : 0;
+
+        std::uint32_t result;
+        if (not op_uses_a(op) && not op_uses_b(op)) {
+            result = bits & 1;
+        }
+        else if (not op_uses_b(op)) {
+            result = a ^ (not(bits >> 2 & 1));
+        }
+        else if (not op_uses_a(op)) {
+            result = b ^ (not(bits >> 1 & 1));
+        }
+        else if (popcount(bits) == 1 || popcount(bits) == 3) {
+            // a single row differs from all others, which is an AND gate with inverted operands or result
+            const bool inverted = popcount(bits) == 3;
+            const unsigned row = static_cast<unsigned>(log2floor((inverted ? ~bits : bits) & 0xf));
+            result = push_and_gate(a ^ not(row >> 1 & 1), b ^ not(row & 1)) ^ inverted;
+        }
+        else {
+            const std::uint32_t a_and_not_b = push_and_gate(a, b ^ 1);
+            const std::uint32_t b_and_not_a = push_and_gate(a ^ 1, b);
+            const std::uint32_t nxor = push_and_gate(a_and_not_b ^ 1, b_and_not_a ^ 1);
+            result = nxor ^ (op == Op::XOR);
+        }
+        literals[i] = result;
+    }
+
+    OutputBuffer out{stream};
+    const auto write_line = [&](const std::uint64_t x) {
+        out.write_number(x);
+        out.write_byte('\n');
+    };
+
+    out.write(binary ? "aig " : "aag ");
+    for (const std::uint64_t field :
+         {netlist.inputs + ands.size(), std::uint64_t{netlist.inputs}, std::uint64_t{0}, netlist.outputs.size()}) {
+        out.write_number(field);
+        out.write_byte(' ');
+    }
+    write_line(ands.size());
+
+    if (not binary) {
+        for (std::uint32_t i = 0; i < netlist.inputs; ++i) {
+            write_line(2 * (i + 1));
+        }
+    }
+    for (const std::uint32_t output : netlist.outputs) {
+        write_line(literals[output]);
+    }
+    for (std::size_t k = 0; k < ands.size(); ++k) {
+        const auto lhs = static_cast<std::uint32_t>(2 * (netlist.inputs + k + 1));
+        const auto [rhs0, rhs1] = ands[k];
+        if (not binary) {
+            out.write_number(lhs);
+            out.write_byte(' ');
+            out.write_number(rhs0);
+            out.write_byte(' ');
+            write_line(rhs1);
+            continue;
+        }
+        for (std::uint32_t delta : {lhs - rhs0, rhs0 - rhs1}) {
+            for (; delta >= 0x80; delta >>= 7) {
+                out.write_byte(static_cast<char>((delta & 0x7f) | 0x80));
+            }
+            out.write_byte(static_cast<char>(delta));
+        }
+    }
+
+    for (std::size_t i = 0; i < netlist.input_names.size(); ++i) {
+        out.write_byte('i');
+        out.write_number(i);
+        out.write_byte(' ');
+        out.write(netlist.input_names[i]);
+        out.write_byte('\n');
+    }
+    for (std::size_t i = 0; i < netlist.output_names.size(); ++i) {
+        out.write_byte('o');
+        out.write_number(i);
+        out.write_byte(' ');
+        out.write(netlist.output_names[i]);
+        out.write_byte('\n');
+    }
+    out.write("c\nwritten by boolexpr\n");
+}
+
+}  // namespace
+
+std::optional<NetlistFormat> netlist_format_of_path(const std::string_view path) noexcept
+{
+    const auto ends_with = [path](const std::string_view suffix) {
+        return path.size() >= suffix.size() && path.substr(path.size() - suffix.size()) == suffix;
+    };
+    if (ends_with(".blif")) {
+        return NetlistFormat::BLIF;
+    }
+    if (ends_with(".aag")) {
+        return NetlistFormat::AIGER_ASCII;
+    }
+    if (ends_with(".aig")) {
+        return NetlistFormat::AIGER_BINARY;
+    }
+    return std::nullopt;
+}
+
+Result<Netlist> read_netlist(std::istream &in, const NetlistFormat format)
+{
+    switch (format) {
+    case NetlistFormat::BLIF: return BlifReader{in}.read();
+    case NetlistFormat::AIGER_ASCII: return AigerReader{in, false}.read();
+    case NetlistFormat::AIGER_BINARY: return AigerReader{in, true}.read();
+    }
+    __builtin_unreachable();
+}
+
+void write_netlist(std::ostream &out, const Netlist &netlist, const NetlistFormat format)
+{
+    switch (format) {
+    case NetlistFormat::BLIF: write_blif(out, netlist); return;
+    case NetlistFormat::AIGER_ASCII: write_aiger(out, netlist, false); return;
+    case NetlistFormat::AIGER_BINARY: write_aiger(out, netlist, true); return;
+    }
+    __builtin_unreachable();
+}
@@ -0,0 +1,30 @@
+#ifndef NETLIST_IO_HPP
+#define NETLIST_IO_HPP
+
+#include <iosfwd>
+#include <optional>
+#include <string_view>
+
+#include "netlist.hpp"
+#include "result.hpp"
+
+enum class NetlistFormat : unsigned char {
+    /// Berkeley Logic Interchange Format
+    BLIF,
+    /// ASCII AIGER (.aag)
+    AIGER_ASCII,
+    /// binary AIGER (.aig)
+    AIGER_BINARY,
+};
+
+/// Determines the format of a netlist file from its extension.
+[[nodiscard]] std::optional<NetlistFormat> netlist_format_of_path(std::string_view path) noexcept;
+
+/// Reads a combinational netlist in the given format.
+/// The input is read in chunks and never held in memory as a whole.
+[[nodiscard]] Result<Netlist> read_netlist(std::istream &in, NetlistFormat format);
+
+/// Writes a netlist in the given format.
+void write_netlist(std::ostream &out, const Netlist &netlist, NetlistFormat format);
+
+#endif  // NETLIST_IO_HPP
@@ -63,7 +63,7 @@ constexpr const char *op_display_label(Op op) noexcept
 
 [[nodiscard]] constexpr bool op_display_is_reversed(Op op) noexcept
 {
-    constexpr unsigned bits = 0b0010'0100'0010'0100;
+    constexpr unsigned bits = 0b0010'0100'0011'0000;
     return bits >> static_cast<unsigned>(op) & 1;
 }
 
@@ -97,4 +97,40 @@ constexpr const char *op_display_label(Op op) noexcept
     return bits >> static_cast<unsigned>(op) & 1;
 }
 
+[[nodiscard]] constexpr bool op_uses_a(Op op) noexcept
+{
+    const unsigned bits = static_cast<unsigned>(op);
+    return ((bits ^ bits >> 2) & 0b0011u) != 0;
+}
+
+[[nodiscard]] constexpr bool op_uses_b(Op op) noexcept
+{
+    const unsigned bits = static_cast<unsigned>(op);
+    return ((bits ^ bits >> 1) & 0b0101u) != 0;
+}
+
+/// Returns the operation which computes op(b, a).
+[[nodiscard]] constexpr Op op_transpose(const Op op) noexcept
+{
+    const unsigned bits = static_cast<unsigned>(op);
+    return static_cast<Op>((bits & 0b1001u) | (bits & 0b0010u) << 1 | (bits & 0b0100u) >> 1);
+}
+
+/// Applies the operation to every bit of the operands.
+template <typename T>
+[[nodiscard]] constexpr T op_apply(Op op, const T a, const T b) noexcept
+{
+    const unsigned bits = static_cast<unsigned>(op);
+    const auto mask = [bits](const unsigned i) -> T {
+        return static_cast<T>(-static_cast<T>(bits >> i & 1));
+    };
+    return static_cast<T>((mask(0) & ~a & ~b) | (mask(1) & ~a & b) | (mask(2) & a & ~b) | (mask(3) & a & b));
+}
+
+static_assert(op_uses_a(Op::NOT_A) && not op_uses_b(Op::NOT_A));
+static_assert(not op_uses_a(Op::B) && op_uses_b(Op::B));
+static_assert(not op_uses_a(Op::TRUE) && not op_uses_b(Op::TRUE));
+static_assert(op_apply(Op::A_ANDN_B, 0b1100u, 0b1010u) == 0b0100u);
+static_assert(op_transpose(Op::A_ANDN_B) == Op::B_ANDN_A && op_transpose(Op::XOR) == Op::XOR);
+
 #endif  // OPERATION_HPP
@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <array>
+
+#include "ordering.hpp"
+
+namespace {
+
+/// Counts the operations of the programs it consumes.
+class OpCounter final : public ProgramConsumer {
+public:
+    std::array<std::uint64_t, 16> counts{};
+
+    void operator()(const Instruction *const ins, const std::size_t count) final
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            ++counts[ins[i].op];
+        }
+    }
+};
+
+}  // namespace
+
+std::vector<Op> learn_op_order(const std::vector<TruthTable> &tables,
+                               const InstructionSet instructionSet,
+                               const std::size_t variables,
+                               const SearchLimits &limits)
+{
+    std::vector<Op> result;
+    for (std::uint64_t opcode = to_underlying(instructionSet); opcode != 0; opcode >>= 4) {
+        result.push_back(static_cast<Op>(opcode & 0xf));
+    }
+
+    OpCounter total;
+    for (const TruthTable table : tables) {
+        OpCounter counter;
+        const SearchResult search = find_equivalent_programs(counter, table, instructionSet, variables, false, limits);
+        if (search.status != SearchStatus::FOUND) {
+            continue;
+        }
+        for (std::size_t op = 0; op < total.counts.size(); ++op) {
+            total.counts[op] += counter.counts[op];
+        }
+    }
+
+    // stable, so that operations which occur equally often keep the order of the instruction set
+    std::stable_sort(result.begin(), result.end(), [&total](const Op x, const Op y) {
+        return total.counts[to_underlying(x)] > total.counts[to_underlying(y)];
+    });
+    return result;
+}
@@ -0,0 +1,59 @@
+#ifndef ORDERING_HPP
+#define ORDERING_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "program.hpp"
+
+/// The order in which the search tries the candidate instructions of a node, so that the first matching program of
+/// a length is found sooner. Candidates are tried in descending order of the column_score of their results, and
+/// candidates of equal score in the given order of operations.
+/// The searched programs stay the same, and so does the length of the programs found, only which of them is found
+/// first can change. Proving that no program of a length matches visits exactly as many nodes as without ordering.
+struct MoveOrdering {
+    /// a permutation of the operations of the instruction set, or empty to keep the order of the instruction set
+    std::vector<Op> ops;
+    /// the number of levels above the leaves whose children are tried in the usual order, because their subtrees are
+    /// too small to make up for the cost of ordering
+    std::size_t unordered_levels = 2;
+};
+
+/// Returns how promising a value whose truth table is the column is as an operand of a program equivalent to the
+/// table: the number of rows on which it agrees with the table, or disagrees if that is more.
+/// The agreement is also counted separately within both cofactors of every variable, so that a value which matches
+/// or complements the table in one cofactor and correlates with it in the other one scores highly as well.
+/// Rows which are don't cares of the table are ignored.
+[[nodiscard]] inline unsigned column_score(const std::uint64_t column,
+                                           const TruthTable table,
+                                           const std::size_t variables) noexcept
+{
+    const std::uint64_t care = ~table.dont_care() & truth_table_rows(variables);
+    const std::uint64_t differences = (column ^ table.f) & care;
+    const auto rows = static_cast<unsigned>(popcount(care));
+    const auto disagreements = static_cast<unsigned>(popcount(differences));
+
+    unsigned result = std::max(disagreements, rows - disagreements);
+    for (std::size_t v = 0; v < variables; ++v) {
+        unsigned agreements = 0;
+        for (const std::uint64_t half : {VARIABLE_ROWS[v], ~VARIABLE_ROWS[v]}) {
+            const std::uint64_t cofactor = half & care;
+            const auto cofactor_rows = static_cast<unsigned>(popcount(cofactor));
+            const auto cofactor_disagreements = static_cast<unsigned>(popcount(differences & cofactor));
+            agreements += std::max(cofactor_disagreements, cofactor_rows - cofactor_disagreements);
+        }
+        result = std::max(result, agreements);
+    }
+    return result;
+}
+
+/// Returns the operations of the instruction set, ordered by how often they occur in the first shortest programs of
+/// the tables, which all have the given number of variables. Tables whose search hits the limits are skipped.
+[[nodiscard]] std::vector<Op> learn_op_order(const std::vector<TruthTable> &tables,
+                                             InstructionSet instructionSet,
+                                             std::size_t variables,
+                                             const SearchLimits &limits = {});
+
+#endif  // ORDERING_HPP
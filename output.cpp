@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+
+#include "output.hpp"
+#include "trace.hpp"
+
+namespace {
+
+/// the largest record in the ring: the length of a program followed by its instructions
+constexpr std::size_t MAX_RECORD_SIZE = 1 + 3 * Program::instruction_count;
+
+static_assert(MAX_RECORD_SIZE <= SpscByteRing::capacity);
+static_assert(Program::instruction_count <= 0xff, "program lengths must fit into one byte");
+
+/// a stream buffer which appends everything to a string, so that streams can format into a reused buffer
+class StringAppender : public std::streambuf {
+private:
+    std::string &buffer;
+
+public:
+    explicit StringAppender(std::string &buffer) noexcept : buffer{buffer} {}
+
+protected:
+    int_type overflow(const int_type c) final
+    {
+        if (not traits_type::eq_int_type(c, traits_type::eof())) {
+            buffer += traits_type::to_char_type(c);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char *const s, const std::streamsize n) final
+    {
+        buffer.append(s, static_cast<std::size_t>(n));
+        return n;
+    }
+};
+
+}  // namespace
+
+bool SpscByteRing::try_write(const void *const bytes, const std::size_t size) noexcept
+{
+    const std::uint64_t t = tail.load(std::memory_order_relaxed);
+    if (t + size - cached_head > capacity) {
+        cached_head = head.load(std::memory_order_acquire);
+        if (t + size - cached_head > capacity) {
+            return false;
+        }
+    }
+
+    const std::size_t start = static_cast<std::size_t>(t) & mask;
+    const std::size_t first = std::min(size, capacity - start);
+    std::memcpy(data.get() + start, bytes, first);
+    std::memcpy(data.get(), static_cast<const std::uint8_t *>(bytes) + first, size - first);
+    tail.store(t + size, std::memory_order_release);
+    return true;
+}
+
+void SpscByteRing::peek(void *const bytes, const std::size_t offset, const std::size_t size) const noexcept
+{
+    const std::size_t start = static_cast<std::size_t>(head.load(std::memory_order_relaxed) + offset) & mask;
+    const std::size_t first = std::min(size, capacity - start);
+    std::memcpy(bytes, data.get() + start, first);
+    std::memcpy(static_cast<std::uint8_t *>(bytes) + first, data.get(), size - first);
+}
+
+AsyncProgramWriter::AsyncProgramWriter(std::ostream &out, const OutputFormat format, const Program &prototype)
+    : out{out}, format{format}, program{prototype.variables}
+{
+    program.symbols = prototype.symbols;
+    buffer.reserve(flush_threshold + MAX_RECORD_SIZE * 8);
+    if (format == OutputFormat::BINARY) {
+        write_header();
+    }
+    writer = std::thread{&AsyncProgramWriter::run, this};
+}
+
+AsyncProgramWriter::~AsyncProgramWriter()
+{
+    finish();
+}
+
+void AsyncProgramWriter::operator()(const Instruction *const ins, const std::size_t count)
+{
+    if (done.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::uint8_t record[MAX_RECORD_SIZE];
+    record[0] = static_cast<std::uint8_t>(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        record[1 + 3 * i] = ins[i].op;
+        record[2 + 3 * i] = ins[i].a;
+        record[3 + 3 * i] = ins[i].b;
+    }
+
+    const std::size_t size = 1 + 3 * count;
+    while (not ring.try_write(record, size)) {
+        // the writer is behind by megabytes of output, so it is certainly awake
+        std::this_thread::yield();
+    }
+
+    // pairs with the fence in run, so that either the writer sees the record or we see it going to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed)) {
+        notify();
+    }
+}
+
+void AsyncProgramWriter::finish()
+{
+    if (not writer.joinable()) {
+        return;
+    }
+    done.store(true, std::memory_order_release);
+    notify();
+    writer.join();
+    out.flush();
+}
+
+void AsyncProgramWriter::notify()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+    wake.notify_one();
+}
+
+void AsyncProgramWriter::run()
+{
+    StringAppender appender{buffer};
+    std::ostream stream{&appender};
+    bool first = true;
+    set_trace_thread_name("output");
+
+    while (true) {
+        std::size_t available = ring.readable();
+        if (available == 0) {
+            flush();
+            std::unique_lock<std::mutex> lock{mutex};
+            sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            wake.wait(lock, [this] { return ring.readable() != 0 || done.load(std::memory_order_acquire); });
+            sleeping.store(false, std::memory_order_relaxed);
+            if (ring.readable() == 0) {
+                break;
+            }
+            continue;
+        }
+
+        const TraceScope trace{"format programs", "bytes", available};
+        while (available != 0) {
+            std::uint8_t record[MAX_RECORD_SIZE];
+            ring.peek(record, 0, 1);
+            const std::size_t count = record[0];
+            const std::size_t size = 1 + 3 * count;
+            ring.peek(record + 1, 1, size - 1);
+            ring.consume(size);
+            available -= size;
+
+            if (format == OutputFormat::BINARY) {
+                buffer.append(reinterpret_cast<const char *>(record), size);
+            }
+            else {
+                program.clear();
+                for (std::size_t i = 0; i < count; ++i) {
+                    program.push({record[1 + 3 * i], record[2 + 3 * i], record[3 + 3 * i]});
+                }
+                format_program(stream, first);
+                first = false;
+            }
+
+            if (buffer.size() >= flush_threshold) {
+                flush();
+            }
+        }
+    }
+    flush();
+}
+
+void AsyncProgramWriter::write_header()
+{
+    buffer.append(BINARY_OUTPUT_MAGIC, sizeof(BINARY_OUTPUT_MAGIC));
+    buffer += static_cast<char>(program.variables);
+    for (std::size_t i = 0; i < program.variables; ++i) {
+        const std::string symbol = program.symbol(i, false);
+        buffer += static_cast<char>(std::min<std::size_t>(symbol.size(), 0xff));
+        buffer.append(symbol, 0, 0xff);
+    }
+}
+
+void AsyncProgramWriter::format_program(std::ostream &stream, const bool first)
+{
+    switch (format) {
+    case OutputFormat::EXPRESSION: append_program_as_expression(buffer, program); break;
+    case OutputFormat::PROGRAM:
+        if (not first) {
+            buffer += '\n';
+        }
+        stream << program;
+        break;
+    case OutputFormat::EXPRESSION_AND_PROGRAM:
+        if (not first) {
+            buffer += '\n';
+        }
+        append_program_as_expression(buffer, program);
+        stream << program;
+        break;
+    case OutputFormat::BINARY: break;
+    }
+}
+
+void AsyncProgramWriter::flush()
+{
+    if (buffer.empty()) {
+        return;
+    }
+    const TraceScope trace{"write output", "bytes", buffer.size()};
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.flush();
+    buffer.clear();
+}
@@ -0,0 +1,110 @@
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "program.hpp"
+
+enum class OutputFormat : unsigned char {
+    /// each program as one expression per line
+    EXPRESSION,
+    /// each program as a listing of instructions, separated by empty lines
+    PROGRAM,
+    /// each program as an expression, followed by its listing
+    EXPRESSION_AND_PROGRAM,
+    /// a compact binary stream for machine consumers, see BINARY_OUTPUT_MAGIC
+    BINARY,
+};
+
+/// The binary output starts with these four bytes, followed by the number of variables as one byte and, for every
+/// variable, the length of its symbol as one byte and the symbol itself.
+/// Every program is then written as its length as one byte, followed by op, a, and b of every instruction.
+inline constexpr char BINARY_OUTPUT_MAGIC[4]{'B', 'X', 'P', '1'};
+
+/// a fixed-capacity byte queue between exactly one producer and exactly one consumer thread, without locks
+class SpscByteRing {
+public:
+    static constexpr std::size_t capacity = std::size_t{1} << 22;
+
+private:
+    static constexpr std::size_t mask = capacity - 1;
+    static constexpr std::size_t cache_line = 64;
+
+    std::unique_ptr<std::uint8_t[]> data{new std::uint8_t[capacity]};
+    /// the number of bytes ever read, only written by the consumer
+    alignas(cache_line) std::atomic<std::uint64_t> head{0};
+    /// the producer's copy of head, refreshed only when the ring looks full
+    alignas(cache_line) std::uint64_t cached_head = 0;
+    /// the number of bytes ever written, only written by the producer
+    alignas(cache_line) std::atomic<std::uint64_t> tail{0};
+
+public:
+    /// Appends the bytes if there is enough space, otherwise does nothing and returns false.
+    [[nodiscard]] bool try_write(const void *bytes, std::size_t size) noexcept;
+
+    /// Returns the number of bytes which can be read.
+    [[nodiscard]] std::size_t readable() const noexcept
+    {
+        return static_cast<std::size_t>(tail.load(std::memory_order_acquire) - head.load(std::memory_order_relaxed));
+    }
+
+    /// Copies readable bytes out of the ring without releasing their space.
+    void peek(void *bytes, std::size_t offset, std::size_t size) const noexcept;
+
+    /// Releases the space of bytes which have been read.
+    void consume(std::size_t size) noexcept
+    {
+        head.store(head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+    }
+};
+
+/// Formats programs on a dedicated writer thread, so that the search thread never blocks on I/O.
+/// Programs are handed over through a lock-free ring buffer, and formatted into a large buffer which is reused.
+/// The consumer must only be invoked from one thread at a time.
+class AsyncProgramWriter : public ProgramConsumer {
+private:
+    static constexpr std::size_t flush_threshold = std::size_t{1} << 20;
+
+    std::ostream &out;
+    const OutputFormat format;
+    /// the variables and symbols of every program
+    Program program;
+    std::string buffer;
+
+    SpscByteRing ring;
+    std::atomic<bool> done{false};
+    std::atomic<bool> sleeping{false};
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread writer;
+
+public:
+    /// The prototype provides the variables and symbols of all programs.
+    AsyncProgramWriter(std::ostream &out, OutputFormat format, const Program &prototype);
+
+    AsyncProgramWriter(const AsyncProgramWriter &) = delete;
+    AsyncProgramWriter &operator=(const AsyncProgramWriter &) = delete;
+
+    ~AsyncProgramWriter() final;
+
+    void operator()(const Instruction *ins, std::size_t count) final;
+
+    /// Writes all programs consumed so far and stops the writer thread. Further programs are ignored.
+    void finish();
+
+private:
+    void run();
+    void notify();
+    void write_header();
+    void format_program(std::ostream &stream, bool first);
+    void flush();
+};
+
+#endif  // OUTPUT_HPP
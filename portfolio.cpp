@@ -0,0 +1,154 @@
+#include <thread>
+
+#include "heuristic.hpp"
+#include "portfolio.hpp"
+#include "trace.hpp"
+
+namespace {
+
+/// collects all programs so that they can be replayed later into another consumer
+struct BufferingProgramConsumer : public ProgramConsumer {
+    std::vector<Instruction> instructions;
+    std::vector<std::size_t> lengths;
+
+    void operator()(const Instruction *ins, const std::size_t count) final
+    {
+        instructions.insert(instructions.end(), ins, ins + count);
+        lengths.push_back(count);
+    }
+
+    void replay(ProgramConsumer &consumer) const
+    {
+        const Instruction *ins = instructions.data();
+        for (const std::size_t length : lengths) {
+            consumer(ins, length);
+            ins += length;
+        }
+    }
+};
+
+struct EngineRun {
+    Engine engine;
+    BufferingProgramConsumer buffer;
+    std::chrono::nanoseconds elapsed{};
+};
+
+constexpr unsigned NO_WINNER = ~0u;
+
+bool run_engine(EngineRun &run,
+                const TruthTable table,
+                const InstructionSet instructionSet,
+                const std::size_t variables,
+                const bool greedy,
+                const SearchLimits &limits)
+{
+    switch (run.engine) {
+    case Engine::TRIVIAL: return find_trivial_program(run.buffer, table, variables);
+    case Engine::DFS:
+    case Engine::DFS_REVERSE: {
+        // only a complete answer can win, a truncated greedy one would hide the programs it never found
+        const SearchOptions options{run.engine == Engine::DFS ? SearchOrder::FORWARD : SearchOrder::REVERSE};
+        const SearchResult result =
+            find_equivalent_programs(run.buffer, table, instructionSet, variables, greedy, limits, options);
+        return result.found() && result.complete;
+    }
+    case Engine::HEURISTIC:
+        // a heuristic program only counts if it provably can't be beaten, and it can't enumerate all optima
+        return not greedy && find_heuristic_program(run.buffer, table, variables).is_proven_optimal();
+    }
+    __builtin_unreachable();
+}
+
+/// Runs the engines one after the other on the calling thread, passing their programs straight to the consumer.
+/// Both orders of the search enumerate the same optimal programs and the heuristic can't enumerate them at all, so
+/// only the first search engine is run.
+PortfolioResult find_all_programs_sequentially(ProgramConsumer &consumer,
+                                               const TruthTable table,
+                                               const InstructionSet instructionSet,
+                                               const std::size_t variables,
+                                               const SearchLimits &limits,
+                                               const std::vector<Engine> &engines)
+{
+    for (const Engine engine : engines) {
+        const TraceScope trace{engine_label(engine)};
+        const auto start = std::chrono::steady_clock::now();
+        bool found = false;
+        bool complete = true;
+        switch (engine) {
+        case Engine::TRIVIAL: found = find_trivial_program(consumer, table, variables); break;
+        case Engine::DFS:
+        case Engine::DFS_REVERSE: {
+            const SearchOptions options{engine == Engine::DFS ? SearchOrder::FORWARD : SearchOrder::REVERSE};
+            const SearchResult result =
+                find_equivalent_programs(consumer, table, instructionSet, variables, true, limits, options);
+            if (not result.found()) {
+                return {false, Engine::TRIVIAL, {}};
+            }
+            found = true;
+            complete = result.complete;
+            break;
+        }
+        case Engine::HEURISTIC: break;
+        }
+        if (found) {
+            return {true, engine, std::chrono::steady_clock::now() - start, complete};
+        }
+    }
+    return {false, Engine::TRIVIAL, {}};
+}
+
+}  // namespace
+
+PortfolioResult find_equivalent_programs_portfolio(ProgramConsumer &consumer,
+                                                   const TruthTable table,
+                                                   const InstructionSet instructionSet,
+                                                   const std::size_t variables,
+                                                   const bool greedy,
+                                                   const SearchLimits &caller_limits,
+                                                   const std::vector<Engine> &engines)
+{
+    if (greedy) {
+        return find_all_programs_sequentially(consumer, table, instructionSet, variables, caller_limits, engines);
+    }
+
+    std::vector<EngineRun> runs;
+    runs.reserve(engines.size());
+    for (const Engine engine : engines) {
+        runs.push_back({engine, {}, {}});
+    }
+
+    // the winner cancels the other engines through a token of its own, which the caller can still cancel as well
+    CancellationToken cancellation{caller_limits.cancellation};
+    SearchLimits limits = caller_limits;
+    limits.cancellation = &cancellation;
+    std::atomic<unsigned> winner{NO_WINNER};
+
+    std::vector<std::thread> threads;
+    threads.reserve(runs.size());
+    for (unsigned i = 0; i < runs.size(); ++i) {
+        threads.emplace_back([&, i] {
+            EngineRun &run = runs[i];
+            set_trace_thread_name(engine_label(run.engine));
+            const TraceScope trace{engine_label(run.engine)};
+            const auto start = std::chrono::steady_clock::now();
+            const bool found = run_engine(run, table, instructionSet, variables, greedy, limits);
+            run.elapsed = std::chrono::steady_clock::now() - start;
+
+            unsigned expected = NO_WINNER;
+            if (found && winner.compare_exchange_strong(expected, i)) {
+                cancellation.cancel();
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    const unsigned winner_index = winner.load();
+    if (winner_index == NO_WINNER) {
+        return {false, Engine::TRIVIAL, {}};
+    }
+    const EngineRun &run = runs[winner_index];
+    run.buffer.replay(consumer);
+    return {true, run.engine, run.elapsed};
+}
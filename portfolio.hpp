@@ -0,0 +1,63 @@
+#ifndef PORTFOLIO_HPP
+#define PORTFOLIO_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "program.hpp"
+
+#define BOOLEXPR_ENUM_LIST_ENGINE          \
+    BOOLEXPR_ENUM_ACTION(TRIVIAL, trivial) \
+    BOOLEXPR_ENUM_ACTION(DFS, dfs)         \
+    BOOLEXPR_ENUM_ACTION(DFS_REVERSE, dfs-reverse) \
+    BOOLEXPR_ENUM_ACTION(HEURISTIC, heuristic)
+
+#define BOOLEXPR_ENUM_ACTION(e, label) e,
+/// a strategy which can take part in a portfolio search
+enum class Engine : unsigned char { BOOLEXPR_ENUM_LIST_ENGINE };
+#undef BOOLEXPR_ENUM_ACTION
+
+[[nodiscard]] constexpr const char *engine_label(Engine engine) noexcept
+{
+#define BOOLEXPR_ENUM_ACTION(e, label) \
+    case Engine::e: return #label;
+    switch (engine) {
+        BOOLEXPR_ENUM_LIST_ENGINE
+    }
+    __builtin_unreachable();
+}
+#undef BOOLEXPR_ENUM_ACTION
+
+/// the engines used by a portfolio search when none are configured explicitly
+inline const std::vector<Engine> DEFAULT_PORTFOLIO{Engine::TRIVIAL,
+                                                   Engine::HEURISTIC,
+                                                   Engine::DFS,
+                                                   Engine::DFS_REVERSE};
+
+struct PortfolioResult {
+    /// true if any engine found a proven optimal program
+    bool found;
+    /// the engine whose programs were passed to the consumer, only meaningful if found is true
+    Engine winner;
+    /// the time it took the winner to finish
+    std::chrono::nanoseconds elapsed;
+    /// false if the winner of a greedy portfolio stopped at a limit before it passed all optimal programs on
+    bool complete = true;
+};
+
+/// Runs every engine on its own thread and passes the programs of the first engine to finish with a proven optimal
+/// answer to the consumer. All other engines are cancelled as soon as there is a winner.
+/// The consumer is only ever invoked from the calling thread.
+/// The limits apply to every engine on its own, so there is no winner if all engines stop at them.
+/// A greedy portfolio runs only the trivial search and the first search engine instead, one after the other on the
+/// calling thread, so that the programs are streamed to the consumer as they are found rather than buffered.
+PortfolioResult find_equivalent_programs_portfolio(ProgramConsumer &consumer,
+                                                   TruthTable table,
+                                                   InstructionSet instructionSet,
+                                                   std::size_t variables,
+                                                   bool greedy,
+                                                   const SearchLimits &limits = {},
+                                                   const std::vector<Engine> &engines = DEFAULT_PORTFOLIO);
+
+#endif  // PORTFOLIO_HPP
@@ -2,107 +2,240 @@
 #include <iostream>
 
 #include "bruteforce.hpp"
+#include "heuristic.hpp"
+#include "ordering.hpp"
+#include "pruning.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 
 #include "program.hpp"
 
 namespace {
 
-template <typename P>
-[[nodiscard]] constexpr bool program_emulate_once(const P &program, typename P::state_type state) noexcept
-{
-    bool res = false;
-    for (unsigned i = 0; i < program.size(); ++i) {
-        const auto &ins = program[i];
-        const bool a = get_bit(state, ins.a);
-        const bool b = get_bit(state, ins.b);
-        res = ins.op >> (a << 1 | b) & 1;
-        set_bit_if(state, i + 6, res);
-    }
-    return res;
-}
+enum class FinderDecision : unsigned char {
+    ABORT,
+    KEEP_SEARCHING,
+};
 
-enum class TruthTableMode { TEST, FIND };
+/// Counts the nodes visited by a search and checks whether it has reached any of its limits.
+/// Only the node budget is checked for every node, the other limits are comparatively expensive to check.
+class SearchLimiter {
+private:
+    /// the number of nodes between two checks of the deadline and the cancellation token
+    static constexpr std::uint64_t LIMIT_CHECK_INTERVAL = 4096;
 
-template <TruthTableMode Mode, typename P, typename V>
-[[nodiscard]] constexpr std::uint64_t program_emulate(const P &program,
-                                                      const V variables,
-                                                      const TruthTable table [[maybe_unused]] = {}) noexcept
-{
-    // const auto limit = std::size_t{1} << variables;
-
-    std::uint64_t result = 0;
-    for (std::uint64_t v = 0; v < std::size_t{1} << variables; ++v) {
-        const bool res = program_emulate_once(program, v);
-        if constexpr (Mode == TruthTableMode::TEST) {
-            const bool expected = (res ? table.f : table.t) >> v & 1;
-            if (res != expected) {
-                return false;
-            }
+    SearchLimits limits;
+    std::uint64_t nodes = 0;
+    std::uint64_t next_limit_check = 0;
+    bool stopped = false;
+
+public:
+    explicit SearchLimiter(const SearchLimits &limits) noexcept : limits{limits} {}
+
+    /// Counts the visited node and returns true if the search has to stop.
+    bool visit() noexcept
+    {
+        if (++nodes < next_limit_check) {
+            return false;
         }
-        else {
-            result |= std::uint64_t{res} << v;
+        if (not stopped) {
+            stopped = nodes >= limits.node_budget || std::chrono::steady_clock::now() >= limits.deadline ||
+                      (limits.cancellation != nullptr && limits.cancellation->is_cancelled());
+            next_limit_check = std::min(limits.node_budget, nodes + LIMIT_CHECK_INTERVAL);
         }
+        return stopped;
     }
-    return Mode == TruthTableMode::TEST ? 1u : result;
-}
 
-enum class FinderDecision : unsigned char {
-    ABORT,
-    KEEP_SEARCHING,
+    bool was_stopped() const noexcept
+    {
+        return stopped;
+    }
+
+    std::uint64_t visited_nodes() const noexcept
+    {
+        return nodes;
+    }
+};
+
+/// a candidate instruction whose result has the score
+struct OrderedCandidate {
+    Op op;
+    std::uint8_t a;
+    std::uint8_t b;
+    unsigned score;
 };
 
-template <InstructionSet InstructionSet>
+/// Configurable finders can count their work into a SearchStats, test candidates with a PruningPipeline instead of
+/// can_push and try them in the order of a MoveOrdering. Finders which are not configurable are compiled without any.
+template <InstructionSet InstructionSet, SearchOrder Order = SearchOrder::FORWARD, bool Configurable = false>
 class ProgramFinder {
 private:
     using program_type = CanonicalProgram;
 
-    ProgramConsumer &consumer;
+    /// where matching programs go, unless they are only counted
+    ProgramConsumer *consumer = nullptr;
+    ProgramCount *count = nullptr;
     program_type program;
     TruthTable table;
     std::size_t variables;
+    SearchLimiter limiter;
     bool found = false;
     bool greedy = false;
+    SearchStats *stats = nullptr;
+    PruningPipeline *pipeline = nullptr;
+    const MoveOrdering *ordering = nullptr;
+    /// the truth tables of the operands of the program, only computed with a move ordering
+    std::uint64_t columns[VARIABLE_COUNT + program_type::instruction_count];
+    /// the candidates of every level of the recursion, each level on top of those of its parents
+    std::vector<OrderedCandidate> candidates;
 
 public:
     explicit ProgramFinder(ProgramConsumer &consumer,
                            const TruthTable table,
                            const std::size_t variables,
                            const std::size_t target_length,
-                           const bool greedy) noexcept
-        : consumer{consumer}
+                           const bool greedy,
+                           const SearchLimits &limits = {},
+                           const SearchOptions &options = {}) noexcept
+        : consumer{&consumer}
         , program{target_length, table.relevancy(variables)}
         , table{table}
         , variables{variables}
+        , limiter{limits}
+        , greedy{greedy}
+        , stats{options.stats}
+        , pipeline{options.pipeline}
+        , ordering{options.ordering}
+    {
+        if (ordering != nullptr) {
+            std::copy(VARIABLE_ROWS, VARIABLE_ROWS + variables, columns);
+        }
+    }
+
+    /// Counts the matching programs instead of passing them to a consumer.
+    explicit ProgramFinder(ProgramCount &count,
+                           const TruthTable table,
+                           const std::size_t variables,
+                           const bool greedy,
+                           const SearchLimits &limits = {}) noexcept
+        : count{&count}
+        , program{0, table.relevancy(variables)}
+        , table{table}
+        , variables{variables}
+        , limiter{limits}
         , greedy{greedy}
     {
     }
 
-    void find_equivalent_program() noexcept
+    bool was_stopped() const noexcept
     {
-        if (find_equivalent_trivial_program() || find_equivalent_mov_program()) {
-            return;
+        return limiter.was_stopped();
+    }
+
+    std::uint64_t visited_nodes() const noexcept
+    {
+        return limiter.visited_nodes();
+    }
+
+    /// Searches every length in ascending order until programs are found or a limit is reached.
+    /// Every length below the one in the result has been ruled out.
+    SearchResult find_equivalent_program() noexcept
+    {
+        if (find_trivial_program()) {
+            return {SearchStatus::FOUND, visited_nodes(), 1, 1};
         }
 
-        for (std::size_t target_length = 1;; ++target_length) {
+        const std::size_t static_bound = program_length_lower_bound(table, variables);
+        for (std::size_t target_length = 1; target_length <= program_type::instruction_count; ++target_length) {
             program.reset(target_length);
 
-            if (do_find_equivalent_program_switch()) {
-                return;
+            if (search_target_length()) {
+                // a greedy search may have found only some of the programs of the length before it stopped
+                const bool complete = not greedy || not was_stopped();
+                return {SearchStatus::FOUND, visited_nodes(), target_length, target_length, complete};
+            }
+            if (was_stopped()) {
+                return {SearchStatus::STOPPED, visited_nodes(), target_length, std::max(target_length, static_bound)};
             }
         }
+        constexpr std::size_t max_length = program_type::instruction_count;
+        return {SearchStatus::EXHAUSTED, visited_nodes(), max_length, max_length + 1};
+    }
+
+    SearchStatus find_equivalent_program_of_length(const std::size_t length) noexcept
+    {
+        program.reset(length);
+        if (do_find_equivalent_program_switch()) {
+            return SearchStatus::FOUND;
+        }
+        return was_stopped() ? SearchStatus::STOPPED : SearchStatus::EXHAUSTED;
+    }
+
+    bool find_trivial_program() noexcept
+    {
+        return find_equivalent_trivial_program() || find_equivalent_mov_program();
     }
 
 private:
+    /// Searches the target length of the program, timing the search if statistics are kept.
+    bool search_target_length() noexcept
+    {
+        const TraceScope trace{"search length", "length", program.target_length()};
+        if (not Configurable || stats == nullptr) {
+            return do_find_equivalent_program_switch();
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const std::uint64_t start_nodes = visited_nodes();
+        const bool result = do_find_equivalent_program_switch();
+        stats->lengths.push_back(
+            {program.target_length(), visited_nodes() - start_nodes, std::chrono::steady_clock::now() - start});
+        return result;
+    }
+
+    /// Counts the visited node and checks whether any limit has been reached.
+    bool should_stop() noexcept
+    {
+        if (Configurable && stats != nullptr) {
+            ++stats->nodes[program.size()];
+        }
+        return limiter.visit();
+    }
+
+    /// Pushes the instruction if can_push or the pipeline allows it, counting the rule which rejects it otherwise.
+    template <bool Unary>
+    bool try_push(const Op op, const unsigned a, const unsigned b = 0) noexcept
+    {
+        if (Configurable && (pipeline != nullptr || stats != nullptr)) {
+            const CanonicalInstruction ins = make_canonical_instruction<Unary>(program, op, a, b);
+            const PushRule rule = pipeline != nullptr ? pipeline->rejecting_rule<Unary>(program, ins)
+                                                      : rejecting_rule<Unary>(program, ins);
+            if (rule != PushRule::NONE) {
+                if (stats != nullptr) {
+                    ++stats->rejections[static_cast<std::size_t>(rule) - 1];
+                }
+                return false;
+            }
+            program.push(ins);
+            return true;
+        }
+        if constexpr (Unary) {
+            return program.try_push(op, a);
+        }
+        else {
+            return program.try_push(op, a, b);
+        }
+    }
+
     bool find_equivalent_trivial_program() noexcept
     {
         if (table.f == 0) {
-            consumer(&FALSE_INSTRUCTION, 1);
+            emit_constant(FALSE_INSTRUCTION);
             return found = true;
         }
 
         const auto mask = (variables == 6 ? 0 : (std::uint64_t{1} << (std::uint64_t{1} << variables))) - 1;
         if (table.t == mask) {
-            consumer(&TRUE_INSTRUCTION, 1);
+            emit_constant(TRUE_INSTRUCTION);
             return found = true;
         }
         return found;
@@ -127,6 +260,9 @@ private:
     template <typename V>
     FinderDecision do_find_equivalent_program(const V variables) noexcept;
 
+    template <typename V>
+    FinderDecision do_find_ordered_children(const V variables) noexcept;
+
     bool do_find_equivalent_program_switch() noexcept
     {
         switch (variables) {
@@ -140,25 +276,73 @@ private:
         __builtin_unreachable();
     }
 
+    void emit_constant(const Instruction ins)
+    {
+        if (Configurable && stats != nullptr) {
+            ++stats->solutions;
+        }
+        if (count != nullptr) {
+            count->tally(1, 1);
+            return;
+        }
+        (*consumer)(&ins, 1);
+    }
+
     void on_matching_emulation() noexcept
     {
         thread_local std::array<Instruction, program_type::instruction_count> output_buffer;
 
         found = true;
+        if (Configurable && stats != nullptr) {
+            ++stats->solutions;
+        }
+        if (count != nullptr) {
+            count->tally(program.size(), program_depth());
+            return;
+        }
         for (std::size_t i = 0; i < program.size(); ++i) {
             output_buffer[i] = static_cast<Instruction>(program[i]);
         }
-        consumer(output_buffer.data(), program.size());
+        (*consumer)(output_buffer.data(), program.size());
+    }
+
+    /// Returns the number of instructions on the longest path from an input to the result.
+    std::size_t program_depth() const noexcept
+    {
+        std::uint8_t depths[program_type::instruction_count]{};
+        std::uint8_t depth = 0;
+        for (std::size_t i = 0; i < program.size(); ++i) {
+            const Instruction ins = static_cast<Instruction>(program[i]);
+            const Op op = static_cast<Op>(ins.op);
+            depth = 0;
+            if (op_uses_a(op) && ins.a >= 6) {
+                depth = depths[ins.a - 6];
+            }
+            if (op_uses_b(op) && ins.b >= 6) {
+                depth = std::max(depth, depths[ins.b - 6]);
+            }
+            depths[i] = ++depth;
+        }
+        return depth;
     }
 };
 
-template <InstructionSet InstructionSet>
+static_assert(CanonicalProgram::instruction_count < ProgramCount::max_depth);
+
+template <InstructionSet InstructionSet, SearchOrder Order, bool Configurable>
 template <typename V>
-FinderDecision ProgramFinder<InstructionSet>::do_find_equivalent_program(const V variables) noexcept
+FinderDecision ProgramFinder<InstructionSet, Order, Configurable>::do_find_equivalent_program(const V variables) noexcept
 {
     static_assert(std::is_convertible_v<V, unsigned>);
 
+    if (should_stop()) {
+        return FinderDecision::ABORT;
+    }
+
     if (program.size() == program.target_length()) {
+        if (Configurable && stats != nullptr) {
+            ++stats->leaves;
+        }
         if (program_emulate<TruthTableMode::TEST>(program, variables, table)) {
             on_matching_emulation();
             return greedy ? FinderDecision::KEEP_SEARCHING : FinderDecision::ABORT;
@@ -166,113 +350,487 @@ FinderDecision ProgramFinder<InstructionSet>::do_find_equivalent_program(const V
         return FinderDecision::KEEP_SEARCHING;
     }
 
+    if (Configurable && ordering != nullptr && program.target_length() - program.size() > ordering->unordered_levels) {
+        return do_find_ordered_children(variables);
+    }
+
     const auto fix_operand = [variables](const unsigned o) {
         return o + (o >= variables) * (6 - variables);
     };
 
-    for (std::uint64_t opcode = to_underlying(InstructionSet); opcode != 0; opcode >>= 4) {
-        const Op op = static_cast<Op>(opcode & 0xf);
+    const unsigned operand_count = static_cast<unsigned>(program.size() + variables);
+
+    const bool aborted = for_each_candidate<InstructionSet, Order>(
+        operand_count, fix_operand, [&](const auto unary, const Op op, const unsigned a, const unsigned b) {
+            bool pushed;
+            if constexpr (decltype(unary)::value) {
+                pushed = try_push<true>(op, a);
+            }
+            else {
+                pushed = try_push<false>(op, a, b);
+            }
+            if (not pushed) {
+                return false;
+            }
+            if (do_find_equivalent_program(variables) == FinderDecision::ABORT) {
+                return true;
+            }
+            program.pop();
+            return false;
+        });
+    return aborted ? FinderDecision::ABORT : FinderDecision::KEEP_SEARCHING;
+}
+
+/// Tries the same children as do_find_equivalent_program, but with the operations in the order of the move ordering,
+/// and all children in descending order of the column_score of their results.
+template <InstructionSet InstructionSet, SearchOrder Order, bool Configurable>
+template <typename V>
+FinderDecision ProgramFinder<InstructionSet, Order, Configurable>::do_find_ordered_children(const V variables) noexcept
+{
+    constexpr auto default_ops = instruction_set_ops<InstructionSet, Order>();
+    const bool is_default_ops = ordering->ops.empty();
+    const Op *const ops = is_default_ops ? default_ops.data() : ordering->ops.data();
+    const std::size_t op_count = is_default_ops ? default_ops.size() : ordering->ops.size();
+
+    const std::size_t size = program.size();
+    if (size != 0) {
+        const Instruction top = static_cast<Instruction>(program.top());
+        columns[VARIABLE_COUNT + size - 1] = op_apply(static_cast<Op>(top.op), columns[top.a], columns[top.b]);
+    }
+
+    const auto fix_operand = [variables](const unsigned o) {
+        return static_cast<std::uint8_t>(o + (o >= variables) * (VARIABLE_COUNT - variables));
+    };
+    const unsigned operand_count = static_cast<unsigned>(size + variables);
+
+    // the candidates are the same as those of do_find_equivalent_program, including the pairs of commutative operands
+    const std::size_t begin = candidates.size();
+    for (std::size_t k = 0; k < op_count; ++k) {
+        const Op op = ops[k];
         const bool unary = op_is_unary(op);
         const bool commutative = op_is_commutative(op);
+        for (unsigned a = 0; a < operand_count; ++a) {
+            const std::uint8_t a_op = fix_operand(a);
+            for (unsigned b = unary ? 0 : commutative * (a + 1); b < (unary ? 1 : operand_count); ++b) {
+                const std::uint8_t b_op = unary ? 0 : fix_operand(b);
+                const std::uint64_t column = op_apply(op, columns[a_op], columns[b_op]);
+                candidates.push_back({op, a_op, b_op, column_score(column, table, variables)});
+            }
+        }
+    }
+    std::stable_sort(candidates.begin() + static_cast<std::ptrdiff_t>(begin),
+                     candidates.end(),
+                     [](const OrderedCandidate &x, const OrderedCandidate &y) { return x.score > y.score; });
+
+    // the children push candidates of their own, so the candidates of this level are accessed by index
+    const std::size_t end = candidates.size();
+    FinderDecision decision = FinderDecision::KEEP_SEARCHING;
+    for (std::size_t i = begin; i < end && decision == FinderDecision::KEEP_SEARCHING; ++i) {
+        const OrderedCandidate candidate = candidates[i];
+        const bool pushed = op_is_unary(candidate.op) ? try_push<true>(candidate.op, candidate.a)
+                                                      : try_push<false>(candidate.op, candidate.a, candidate.b);
+        if (pushed) {
+            decision = do_find_equivalent_program(variables);
+            if (decision == FinderDecision::KEEP_SEARCHING) {
+                program.pop();
+            }
+        }
+    }
+    candidates.resize(begin);
+    return decision;
+}
 
-        for (unsigned a = 0; a < program.size() + variables; ++a) {
-            const unsigned a_op = fix_operand(a);
+/// Prints a program as one expression in time linear in the size of the program.
+/// Instructions which are used more than once are bound to their name by a let in front of the expression,
+/// instead of being expanded at every use, which would make the output exponential in the depth of the program.
+/// The output is assembled in a reused buffer and written to the stream at once.
+class ExpressionPrinter {
+private:
+    const Program &program;
+    std::string &buffer;
+    std::uint8_t uses[Program::instruction_count]{};
 
-            if (unary) {
-                if (program.try_push(op, a_op)) {
-                    if (do_find_equivalent_program(variables) == FinderDecision::ABORT) {
-                        return FinderDecision::ABORT;
-                    }
-                    program.pop();
-                }
-                continue;
+public:
+    ExpressionPrinter(const Program &program, std::string &buffer) noexcept : program{program}, buffer{buffer}
+    {
+        count_uses();
+    }
+
+    void print()
+    {
+        const std::size_t result = program.size() - 1;
+        for (std::size_t i = 0; i < result; ++i) {
+            if (uses[i] > 1) {
+                buffer += "let ";
+                buffer += program.symbol(i + 6);
+                buffer += " = ";
+                append_instruction(i);
+                buffer += "; ";
             }
+        }
+        append_instruction(result);
+    }
 
-            const unsigned b_start = commutative * (a + 1);
-            for (unsigned b = b_start; b < program.size() + variables; ++b) {
-                const unsigned b_op = fix_operand(b);
-                if (program.try_push(op, a_op, b_op)) {
-                    if (do_find_equivalent_program(variables) == FinderDecision::ABORT) {
-                        return FinderDecision::ABORT;
-                    }
-                    program.pop();
+private:
+    void count_uses() noexcept
+    {
+        const std::size_t result = program.size() - 1;
+        uses[result] = 1;
+        for (std::size_t i = result + 1; i-- > 0;) {
+            if (uses[i] == 0) {
+                continue;
+            }
+            const Instruction ins = program[i];
+            const Op op = static_cast<Op>(ins.op);
+            for (const auto [operand, used] : {pair<unsigned, bool>{ins.a, op_uses_a(op)}, {ins.b, op_uses_b(op)}}) {
+                // counting beyond two is pointless, and saturating keeps the count from overflowing
+                if (used && operand >= 6 && uses[operand - 6] < 2) {
+                    ++uses[operand - 6];
                 }
             }
         }
     }
-    return FinderDecision::KEEP_SEARCHING;
-}
 
-std::ostream &do_print_program_as_expression(std::ostream &out, const Program &program, const std::size_t i)
-{
-    const auto print_operand = [&](const std::size_t j) -> std::ostream & {
-        if (j < 6) {
-            out << program.symbol(j, false);
+    void append_operand(const unsigned operand)
+    {
+        if (operand < 6) {
+            buffer += program.symbol(operand, false);
+        }
+        else if (uses[operand - 6] > 1) {
+            buffer += program.symbol(operand);
         }
         else {
-            do_print_program_as_expression(out, program, j - 6);
-        };
-        return out;
+            append_instruction(operand - 6);
+        }
+    }
+
+    void append_instruction(const std::size_t i)
+    {
+        const Instruction ins = program[i];
+        const Op op = static_cast<Op>(ins.op);
+        if (op_is_trivial(op)) {
+            buffer += op_display_label(op);
+            return;
+        }
+        unsigned a = ins.a;
+        unsigned b = ins.b;
+
+        if (op_display_is_reversed(op)) {
+            std::swap(a, b);
+        }
+        if (op_is_complement(op)) {
+            buffer += op_display_label(Op::NOT_A);
+        }
+        if (not op_is_unary(op)) {
+            buffer += '(';
+        }
+        if (op_display_is_operand_compl(op) && not op_is_unary(op)) {
+            buffer += op_display_label(Op::NOT_A);
+        }
+        append_operand(a);
+
+        if (not op_is_unary(op)) {
+            buffer += ' ';
+            buffer += op_display_label(op);
+            buffer += ' ';
+            append_operand(b);
+            buffer += ')';
+        }
+    }
+};
+
+}  // namespace
+
+ProgramConsumer::~ProgramConsumer() = default;
+
+SearchResult find_equivalent_programs(ProgramConsumer &consumer,
+                                      const TruthTable table,
+                                      const InstructionSet instructionSet,
+                                      const std::size_t variables,
+                                      const bool greedy,
+                                      const SearchLimits &limits,
+                                      const SearchOptions &options)
+{
+    if (not is_supported(instructionSet)) {
+        return {SearchStatus::EXHAUSTED, 0};
+    }
+
+    if (options.stats != nullptr || options.pipeline != nullptr || options.ordering != nullptr) {
+        if (options.order == SearchOrder::REVERSE) {
+            ProgramFinder<InstructionSet::C, SearchOrder::REVERSE, true> finder{
+                consumer, table, variables, 0, greedy, limits, options};
+            return finder.find_equivalent_program();
+        }
+        ProgramFinder<InstructionSet::C, SearchOrder::FORWARD, true> finder{
+            consumer, table, variables, 0, greedy, limits, options};
+        return finder.find_equivalent_program();
+    }
+    if (options.order == SearchOrder::REVERSE) {
+        ProgramFinder<InstructionSet::C, SearchOrder::REVERSE> finder{
+            consumer, table, variables, 0, greedy, limits, options};
+        return finder.find_equivalent_program();
+    }
+    ProgramFinder<InstructionSet::C> finder{consumer, table, variables, 0, greedy, limits, options};
+    return finder.find_equivalent_program();
+}
+
+SearchResult find_equivalent_program_of_length(ProgramConsumer &consumer,
+                                               const TruthTable table,
+                                               const InstructionSet instructionSet,
+                                               const std::size_t variables,
+                                               const std::size_t length,
+                                               const SearchLimits &limits)
+{
+    if (not is_supported(instructionSet)) {
+        return {SearchStatus::EXHAUSTED, 0};
+    }
+    if (length == 0 || length > CanonicalProgram::instruction_count) {
+        return {SearchStatus::EXHAUSTED, 0};
+    }
+
+    ProgramFinder<InstructionSet::C> finder{consumer, table, variables, length, false, limits};
+    const SearchStatus status = finder.find_equivalent_program_of_length(length);
+    return {status, finder.visited_nodes(), length, program_length_lower_bound(table, variables)};
+}
+
+ProgramCount count_equivalent_programs(const TruthTable table,
+                                       const InstructionSet instructionSet,
+                                       const std::size_t variables,
+                                       const SearchLimits &limits)
+{
+    if (not is_supported(instructionSet)) {
+        return ProgramCount{};
+    }
+    ProgramCount result;
+    ProgramFinder<InstructionSet::C> finder{result, table, variables, true, limits};
+    finder.find_equivalent_program();
+    result.complete = not finder.was_stopped();
+    return result;
+}
+
+bool find_trivial_program(ProgramConsumer &consumer, const TruthTable table, const std::size_t variables)
+{
+    ProgramFinder<InstructionSet::C> finder{consumer, table, variables, 0, false};
+    return finder.find_trivial_program();
+}
+
+/// The depth first search of ProgramFinder, with the loop variables of every level of the recursion kept in an
+/// explicit stack of frames, so that the search can be suspended at any matching program and resumed later.
+/// The trivial programs are found by ProgramFinder, which passes them to this state as its consumer.
+struct ProgramEnumerator::State : public ProgramConsumer {
+    /// the loop variables of one level of the search, pointing at the next candidate instruction
+    struct Frame {
+        static constexpr std::uint8_t NO_OPERAND = 0xff;
+
+        /// the index of the operation in the instruction set
+        std::uint8_t op = 0;
+        std::uint8_t a = 0;
+        /// the next second operand, or NO_OPERAND if no candidate with the first operand has been tried yet
+        std::uint8_t b = NO_OPERAND;
     };
 
-    Instruction ins = program[i];
-    Op op = static_cast<Op>(ins.op);
-    if (op_is_trivial(op)) {
-        out << op_display_label(op);
-        return out;
+    CanonicalProgram program;
+    TruthTable table;
+    unsigned variables;
+    SearchLimiter limiter;
+    std::array<Frame, CanonicalProgram::instruction_count + 1> frames{};
+    std::array<Instruction, CanonicalProgram::instruction_count> output{};
+    std::size_t output_size = 0;
+    std::size_t length = 0;
+    SearchStatus status = SearchStatus::STOPPED;
+    bool started = false;
+    bool finished = false;
+    bool found = false;
+    /// true if the top of the program is the matching program which was yielded last
+    bool at_leaf = false;
+
+    State(const TruthTable table, const std::size_t variables, const SearchLimits &limits) noexcept
+        : program{0, table.relevancy(variables)}
+        , table{table}
+        , variables{static_cast<unsigned>(variables)}
+        , limiter{limits}
+    {
     }
-    unsigned a = ins.a;
-    unsigned b = ins.b;
 
-    if (op_display_is_reversed(op)) {
-        std::swap(a, b);
+    void operator()(const Instruction *ins, const std::size_t count) final
+    {
+        std::copy(ins, ins + count, output.begin());
+        output_size = count;
     }
-    if (op_is_complement(op)) {
-        out << op_display_label(Op::NOT_A);
+
+    void begin_length(const std::size_t target_length) noexcept
+    {
+        program.reset(target_length);
+        frames[0] = Frame{};
+        length = target_length;
+        at_leaf = false;
     }
-    if (not op_is_unary(op)) {
-        out << '(';
+
+    void finish(const SearchStatus final_status) noexcept
+    {
+        status = final_status;
+        finished = true;
     }
 
-    if (op_display_is_operand_compl(op) && not op_is_unary(op)) {
-        out << op_display_label(Op::NOT_A);
-        if (a >= 6) {
-            out << '(';
-        }
-        out << op_display_label(Op::NOT_A);
-        print_operand(a);
-        if (a >= 6) {
-            out << ')';
+    /// Pushes the next candidate instruction of the current level onto the program, or returns false if there is
+    /// none left. The candidates come in the same order as in ProgramFinder::do_find_equivalent_program.
+    template <typename V>
+    bool push_next_candidate(Frame &frame, const V variables) noexcept
+    {
+        constexpr auto ops = instruction_set_ops<InstructionSet::C, SearchOrder::FORWARD>();
+        const auto fix_operand = [variables](const unsigned o) {
+            return o + (o >= variables) * (6 - variables);
+        };
+        const unsigned operand_count = static_cast<unsigned>(program.size() + variables);
+
+        for (; frame.op < ops.size(); ++frame.op, frame.a = 0, frame.b = Frame::NO_OPERAND) {
+            const Op op = ops[frame.op];
+            for (; frame.a < operand_count; ++frame.a, frame.b = Frame::NO_OPERAND) {
+                if (op_is_unary(op)) {
+                    if (frame.b == Frame::NO_OPERAND) {
+                        frame.b = 0;
+                        if (program.try_push(op, fix_operand(frame.a))) {
+                            return true;
+                        }
+                    }
+                    continue;
+                }
+                if (frame.b == Frame::NO_OPERAND) {
+                    frame.b = static_cast<std::uint8_t>(op_is_commutative(op) * (frame.a + 1));
+                }
+                while (frame.b < operand_count) {
+                    const unsigned b = frame.b++;
+                    if (program.try_push(op, fix_operand(frame.a), fix_operand(b))) {
+                        return true;
+                    }
+                }
+            }
         }
+        return false;
     }
-    else {
-        print_operand(a);
+
+    /// Resumes the search of the current length until the next matching program.
+    /// Returns false if the length is exhausted or a limit was reached.
+    template <typename V>
+    bool find_next_match(const V variables) noexcept
+    {
+        if (at_leaf) {
+            program.pop();
+            at_leaf = false;
+        }
+        while (true) {
+            const std::size_t level = program.size();
+            if (not push_next_candidate(frames[level], variables)) {
+                if (level == 0) {
+                    return false;
+                }
+                program.pop();
+                continue;
+            }
+            if (limiter.visit()) {
+                return false;
+            }
+            if (program.size() < program.target_length()) {
+                frames[program.size()] = Frame{};
+                continue;
+            }
+            if (program_emulate<TruthTableMode::TEST>(program, variables, table)) {
+                for (std::size_t i = 0; i < program.size(); ++i) {
+                    output[i] = static_cast<Instruction>(program[i]);
+                }
+                output_size = program.size();
+                return at_leaf = true;
+            }
+            program.pop();
+        }
     }
 
-    if (not op_is_unary(op)) {
-        out << ' ' << op_display_label(op) << ' ';
-        print_operand(b) << ')';
+    bool find_next_match_switch() noexcept
+    {
+        switch (variables) {
+        case 1: return find_next_match(constant<1u>);
+        case 2: return find_next_match(constant<2u>);
+        case 3: return find_next_match(constant<3u>);
+        case 4: return find_next_match(constant<4u>);
+        case 5: return find_next_match(constant<5u>);
+        case 6: return find_next_match(constant<6u>);
+        }
+        __builtin_unreachable();
     }
-    return out;
+};
+
+ProgramEnumerator::ProgramEnumerator(const TruthTable table,
+                                     const std::size_t variables,
+                                     const SearchLimits &limits)
+    : state{std::make_unique<State>(table, variables, limits)}
+{
 }
 
-}  // namespace
+ProgramEnumerator::ProgramEnumerator(ProgramEnumerator &&other) noexcept = default;
 
-ProgramConsumer::~ProgramConsumer() = default;
+ProgramEnumerator &ProgramEnumerator::operator=(ProgramEnumerator &&other) noexcept = default;
+
+ProgramEnumerator::~ProgramEnumerator() = default;
 
-void find_equivalent_programs(ProgramConsumer &consumer,
-                              const TruthTable table,
-                              const InstructionSet instructionSet,
-                              const std::size_t variables,
-                              const bool greedy)
+bool ProgramEnumerator::next() noexcept
 {
-    if (instructionSet != InstructionSet::C) {
-        std::cout << "Only C instruction set is supported right now\n";
-        std::exit(1);
+    State &s = *state;
+    if (s.finished) {
+        return false;
+    }
+    if (not s.started) {
+        s.started = true;
+        ProgramFinder<InstructionSet::C> finder{s, s.table, s.variables, 0, false};
+        if (finder.find_trivial_program()) {
+            // there is only ever one trivial program, since all of them compute different functions
+            s.length = 1;
+            s.found = true;
+            s.finish(SearchStatus::FOUND);
+            return true;
+        }
+        s.begin_length(1);
     }
 
-    ProgramFinder<InstructionSet::C> finder{consumer, table, variables, 0, greedy};
-    finder.find_equivalent_program();
+    while (true) {
+        if (s.find_next_match_switch()) {
+            s.found = true;
+            return true;
+        }
+        if (s.limiter.was_stopped()) {
+            s.finish(SearchStatus::STOPPED);
+            return false;
+        }
+        if (s.found || s.length == CanonicalProgram::instruction_count) {
+            s.finish(s.found ? SearchStatus::FOUND : SearchStatus::EXHAUSTED);
+            return false;
+        }
+        s.begin_length(s.length + 1);
+    }
+}
+
+const Instruction *ProgramEnumerator::data() const noexcept
+{
+    return state->output.data();
+}
+
+std::size_t ProgramEnumerator::size() const noexcept
+{
+    return state->output_size;
+}
+
+SearchResult ProgramEnumerator::result() const noexcept
+{
+    const State &s = *state;
+    const std::uint64_t nodes = s.limiter.visited_nodes();
+    if (s.found) {
+        return {SearchStatus::FOUND, nodes, s.length, s.length, not s.limiter.was_stopped()};
+    }
+    if (s.finished && s.status == SearchStatus::EXHAUSTED) {
+        return {SearchStatus::EXHAUSTED, nodes, s.length, s.length + 1};
+    }
+    // every length below the current one has been ruled out
+    const std::size_t static_bound = program_length_lower_bound(s.table, s.variables);
+    return {SearchStatus::STOPPED, nodes, s.length, std::max(s.length, static_bound)};
 }
 
 bool Program::is_equivalent(const TruthTable table) const noexcept
@@ -282,10 +840,63 @@ bool Program::is_equivalent(const TruthTable table) const noexcept
 
 TruthTable Program::compute_truth_table() const noexcept
 {
+    const TraceScope trace{"compute_truth_table"};
     const std::uint64_t table = program_emulate<TruthTableMode::FIND>(*this, static_cast<unsigned>(this->variables));
     return {table, table};
 }
 
+bool Program::uses_only(const InstructionSet instructionSet) const noexcept
+{
+    for (std::size_t i = 0; i < size(); ++i) {
+        if (not instruction_set_contains(instructionSet, static_cast<Op>((*this)[i].op))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Program compact(const Program &program, const unsigned result) noexcept
+{
+    Program compacted{program.variables};
+    compacted.symbols = program.symbols;
+    if (result < VARIABLE_COUNT) {
+        compacted.push(Op::A, result, 0);
+        return compacted;
+    }
+
+    bool live[Program::instruction_count]{};
+    live[result - VARIABLE_COUNT] = true;
+    for (std::size_t i = result - VARIABLE_COUNT + 1; i-- > 0;) {
+        if (not live[i]) {
+            continue;
+        }
+        const Instruction ins = program[i];
+        for (const unsigned operand : {ins.a, ins.b}) {
+            if (operand >= VARIABLE_COUNT) {
+                live[operand - VARIABLE_COUNT] = true;
+            }
+        }
+    }
+
+    unsigned renamed[Program::instruction_count]{};
+    for (std::size_t i = 0; i <= result - VARIABLE_COUNT; ++i) {
+        if (not live[i]) {
+            continue;
+        }
+        Instruction ins = program[i];
+        const auto rename = [&renamed](std::uint8_t &operand) {
+            if (operand >= VARIABLE_COUNT) {
+                operand = static_cast<std::uint8_t>(renamed[operand - VARIABLE_COUNT]);
+            }
+        };
+        rename(ins.a);
+        rename(ins.b);
+        renamed[i] = static_cast<unsigned>(compacted.size() + VARIABLE_COUNT);
+        compacted.push(ins);
+    }
+    return compacted;
+}
+
 std::string Program::symbol(std::size_t i, bool input_prefix) const noexcept
 {
     if (i < 6) {
@@ -311,19 +922,27 @@ std::string Program::symbol(std::size_t i, bool input_prefix) const noexcept
     return result;
 }
 
+void append_program_as_expression(std::string &buffer, const Program &program)
+{
+    if (not program.empty()) {
+        ExpressionPrinter{program, buffer}.print();
+    }
+    buffer += '\n';
+}
+
 std::ostream &print_program_as_expression(std::ostream &out, const Program &program)
 {
-    return do_print_program_as_expression(out, program, program.size() - 1) << '\n';
+    thread_local std::string buffer;
+    buffer.clear();
+    append_program_as_expression(buffer, program);
+    return out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
 }
 
-std::ostream &print_instruction(std::ostream &out, const Instruction ins, const Program &program)
+std::ostream &print_operation(std::ostream &out, const Op op, std::string_view a, std::string_view b)
 {
     constexpr const char *DISPLAY_NOT = op_display_label(Op::NOT_A);
 
-    const Op op = static_cast<Op>(ins.op);
     const char *label = op_display_label(op);
-    unsigned a = ins.a;
-    unsigned b = ins.b;
     if (op_display_is_reversed(op)) {
         std::swap(a, b);
     }
@@ -336,7 +955,7 @@ std::ostream &print_instruction(std::ostream &out, const Instruction ins, const
         if (std::char_traits<char>::length(label) > 1) {
             out << ' ';
         }
-        return out << program.symbol(a);
+        return out << a;
     }
     else {
         if (op_is_complement(op)) {
@@ -348,7 +967,7 @@ std::ostream &print_instruction(std::ostream &out, const Instruction ins, const
                 out << ' ';
             }
         }
-        out << program.symbol(a) << ' ' << label << ' ' << program.symbol(b);
+        out << a << ' ' << label << ' ' << b;
         if (op_is_complement(op)) {
             out << ')';
         }
@@ -356,6 +975,11 @@ std::ostream &print_instruction(std::ostream &out, const Instruction ins, const
     }
 }
 
+std::ostream &print_instruction(std::ostream &out, const Instruction ins, const Program &program)
+{
+    return print_operation(out, static_cast<Op>(ins.op), program.symbol(ins.a), program.symbol(ins.b));
+}
+
 std::ostream &operator<<(std::ostream &out, const Program &program)
 {
     for (std::size_t i = 0; i < program.size(); ++i) {
@@ -2,8 +2,12 @@
 #define PROGRAM_HPP
 
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <iosfwd>
+#include <limits>
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -19,6 +23,24 @@ enum class InstructionSet : std::uint64_t {
     X64 = C | to_underlying(Op::A_ANDN_B) << 16,
 };
 
+/// Returns true if the operation is one of the instruction set.
+[[nodiscard]] constexpr bool instruction_set_contains(const InstructionSet instructionSet, const Op op) noexcept
+{
+    for (std::uint64_t opcode = to_underlying(instructionSet); opcode != 0; opcode >>= 4) {
+        if (static_cast<Op>(opcode & 0xf) == op) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Returns true if the searches support the instruction set, which is only InstructionSet::C right now.
+/// Searches in any other instruction set never find a program.
+[[nodiscard]] constexpr bool is_supported(const InstructionSet instructionSet) noexcept
+{
+    return instructionSet == InstructionSet::C;
+}
+
 struct Instruction {
     /// the truth table of the operation
     std::uint8_t op;
@@ -115,21 +137,189 @@ struct Program : public ProgramBase<Instruction, 250> {
     [[nodiscard]] bool is_equivalent(TruthTable table) const noexcept;
 
     [[nodiscard]] TruthTable compute_truth_table() const noexcept;
+
+    /// Returns true if every operation of the program is one of the instruction set, so that a search in it could
+    /// find the program as well.
+    [[nodiscard]] bool uses_only(InstructionSet instructionSet) const noexcept;
 };
 
+/// Returns the program consisting only of the instructions which the result depends on, ending with the result.
+/// A result which is an input becomes a single move instruction.
+[[nodiscard]] Program compact(const Program &program, unsigned result) noexcept;
+
+struct SearchStats;
+class PruningPipeline;
+struct MoveOrdering;
+
 struct ProgramConsumer {
     virtual ~ProgramConsumer();
     virtual void operator()(const Instruction *ins, std::size_t count) = 0;
 };
 
-void find_equivalent_programs(ProgramConsumer &consumer,
-                              const TruthTable table,
-                              InstructionSet instructionSet,
-                              std::size_t variables,
-                              bool exhaustive);
+/// the order in which the search tries operations and operands
+enum class SearchOrder : unsigned char {
+    /// operations in instruction set order, operands in ascending order
+    FORWARD,
+    /// operations in reverse instruction set order, operands in descending order
+    REVERSE,
+};
+
+/// a flag which can be set from any thread to make a running search stop as soon as possible
+/// A token may have a parent, so that a caller can cancel a group of searches which also cancel each other.
+struct CancellationToken {
+    std::atomic<bool> cancelled{false};
+    /// an optional token which cancels this one as well
+    const CancellationToken *parent = nullptr;
+
+    CancellationToken() noexcept = default;
+
+    explicit CancellationToken(const CancellationToken *parent) noexcept : parent{parent} {}
+
+    void cancel() noexcept
+    {
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool is_cancelled() const noexcept
+    {
+        return cancelled.load(std::memory_order_relaxed) || (parent != nullptr && parent->is_cancelled());
+    }
+};
+
+/// bounds on the work a search may do before it gives up
+struct SearchLimits {
+    /// the point in time after which the search stops
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    /// the number of visited nodes after which the search stops
+    std::uint64_t node_budget = std::numeric_limits<std::uint64_t>::max();
+    /// an optional token through which another thread can stop the search
+    const CancellationToken *cancellation = nullptr;
+};
+
+/// optional configuration of a search, which by default finds the same programs as fast as possible
+struct SearchOptions {
+    SearchOrder order = SearchOrder::FORWARD;
+    /// If statistics are given, the search counts its work into them, which slows it down slightly.
+    SearchStats *stats = nullptr;
+    /// If a pruning pipeline is given, it tests the candidates instead of can_push, see PruningPipeline.
+    PruningPipeline *pipeline = nullptr;
+    /// If a move ordering is given, the candidates are tried in its order, see MoveOrdering.
+    const MoveOrdering *ordering = nullptr;
+};
+
+enum class SearchStatus : unsigned char {
+    /// a matching program was found
+    FOUND,
+    /// every candidate was tried and none matched
+    EXHAUSTED,
+    /// the search hit one of its limits before it could finish
+    STOPPED,
+};
+
+struct SearchResult {
+    SearchStatus status;
+    /// the number of nodes visited by the search
+    std::uint64_t nodes;
+    /// the length of the programs found, or the length being searched when the search stopped or gave up
+    std::size_t length = 0;
+    /// a length which no equivalent program can undercut, equal to the length if the shortest programs were found
+    std::size_t lower_bound = 0;
+    /// false if a greedy search found programs but stopped at one of its limits before it found all of them
+    bool complete = true;
+
+    [[nodiscard]] constexpr bool found() const noexcept
+    {
+        return status == SearchStatus::FOUND;
+    }
+};
+
+/// Finds the shortest programs equivalent to the table and passes them to the consumer.
+/// If the search stops at one of its limits first, the result tells the length at which it stopped and the best
+/// lower bound it proved, every shorter length having been ruled out. A greedy search which stops after it found
+/// some of the shortest programs is found, but not complete.
+SearchResult find_equivalent_programs(ProgramConsumer &consumer,
+                                      const TruthTable table,
+                                      InstructionSet instructionSet,
+                                      std::size_t variables,
+                                      bool exhaustive,
+                                      const SearchLimits &limits = {},
+                                      const SearchOptions &options = {});
+
+/// the number of shortest programs equivalent to a table, without the programs themselves
+struct ProgramCount {
+    static constexpr std::size_t max_depth = 64;
+
+    /// the length of the shortest programs, zero if none were found
+    std::size_t length = 0;
+    /// the number of shortest programs
+    std::uint64_t total = 0;
+    /// the number of shortest programs by depth, the number of instructions on their longest path
+    std::array<std::uint64_t, max_depth> depths{};
+    /// false if the search stopped at one of its limits before all programs were counted
+    bool complete = true;
+
+    void tally(const std::size_t program_length, const std::size_t depth) noexcept
+    {
+        length = program_length;
+        ++total;
+        ++depths[depth];
+    }
+};
+
+/// Counts the shortest programs equivalent to the table, without materializing any of them.
+[[nodiscard]] ProgramCount count_equivalent_programs(const TruthTable table,
+                                                     InstructionSet instructionSet,
+                                                     std::size_t variables,
+                                                     const SearchLimits &limits = {});
+
+/// Searches only the programs of exactly the given length and passes the first match to the consumer.
+/// The lower bound of the result is only what can be proven without searching the shorter lengths.
+/// Programs of length one which are constant or just an input are not considered, see find_trivial_program.
+SearchResult find_equivalent_program_of_length(ProgramConsumer &consumer,
+                                               const TruthTable table,
+                                               InstructionSet instructionSet,
+                                               std::size_t variables,
+                                               std::size_t length,
+                                               const SearchLimits &limits = {});
+
+/// Finds a program of length one (constant or input) equivalent to the table, if there is one.
+bool find_trivial_program(ProgramConsumer &consumer, const TruthTable table, std::size_t variables);
+
+/// Enumerates the shortest programs equivalent to a table one at a time, in the order of a greedy search.
+/// The search runs only while next is called, on an explicit stack of fixed size, so taking the first few programs
+/// costs no more than finding them and the rest of the search is never run.
+class ProgramEnumerator {
+private:
+    struct State;
+    std::unique_ptr<State> state;
+
+public:
+    ProgramEnumerator(TruthTable table, std::size_t variables, const SearchLimits &limits = {});
+    ProgramEnumerator(ProgramEnumerator &&other) noexcept;
+    ProgramEnumerator &operator=(ProgramEnumerator &&other) noexcept;
+    ~ProgramEnumerator();
+
+    /// Advances to the next program and returns true, or returns false once there is none or a limit was reached.
+    [[nodiscard]] bool next() noexcept;
+
+    /// Returns the instructions of the current program, only valid after next returned true.
+    [[nodiscard]] const Instruction *data() const noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    /// Returns how far the search got. The status is FOUND as soon as there is a program, even if the caller never
+    /// pulls the rest, and STOPPED until then.
+    [[nodiscard]] SearchResult result() const noexcept;
+};
+
+/// Prints an operation on two operands with the given names, like a single instruction of a program.
+std::ostream &print_operation(std::ostream &out, Op op, std::string_view a, std::string_view b);
 
 std::ostream &print_instruction(std::ostream &out, Instruction ins, const Program &p);
 
+/// Appends the program as one expression, followed by a newline, to the buffer.
+void append_program_as_expression(std::string &buffer, const Program &program);
+
 std::ostream &print_program_as_expression(std::ostream &out, const Program &program);
 
 std::ostream &operator<<(std::ostream &out, const Program &p);
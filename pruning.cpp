@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <charconv>
+
+#include "pruning.hpp"
+#include "stats.hpp"
+
+std::optional<PushRule> push_rule_parse(const std::string_view str) noexcept
+{
+    unsigned number = 0;
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), number);
+    if (ec == std::errc{} && end == str.data() + str.size()) {
+        if (number >= 1 && number <= PUSH_RULE_COUNT) {
+            return static_cast<PushRule>(number);
+        }
+        return std::nullopt;
+    }
+    for (std::size_t i = 1; i <= PUSH_RULE_COUNT; ++i) {
+        if (str == push_rule_label(static_cast<PushRule>(i))) {
+            return static_cast<PushRule>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+PruningPipeline::PruningPipeline(const bool adaptive) noexcept : adaptive{adaptive}
+{
+    for (std::size_t i = 0; i < PUSH_RULE_COUNT; ++i) {
+        rules[i] = static_cast<PushRule>(i + 1);
+    }
+}
+
+void PruningPipeline::set_enabled(const PushRule rule, const bool enabled) noexcept
+{
+    if (rule == PushRule::NONE || is_enabled(rule) == enabled) {
+        return;
+    }
+    // the rule moves to the boundary between the enabled and disabled rules, and the boundary moves past it
+    const auto it = std::find(rules.begin(), rules.end(), rule);
+    if (enabled) {
+        std::rotate(rules.begin() + static_cast<std::ptrdiff_t>(enabled_count), it, it + 1);
+        ++enabled_count;
+    }
+    else {
+        std::rotate(it, it + 1, rules.begin() + static_cast<std::ptrdiff_t>(enabled_count));
+        --enabled_count;
+    }
+}
+
+bool PruningPipeline::is_enabled(const PushRule rule) const noexcept
+{
+    return std::find(begin(), end(), rule) != end();
+}
+
+void PruningPipeline::reorder() noexcept
+{
+    // rules which are too cheap to be measured by the clock get the smallest measurable cost instead
+    const auto score = [this](const PushRule rule) {
+        const std::size_t index = static_cast<std::size_t>(rule) - 1;
+        const auto cost = std::max(sampled_time[index].count(), std::chrono::nanoseconds::rep{1});
+        return static_cast<double>(sampled_rejections[index]) / static_cast<double>(cost);
+    };
+    // stable, so that rules of equal score keep their order and the order only changes when the scores do
+    std::stable_sort(rules.begin(), rules.begin() + static_cast<std::ptrdiff_t>(enabled_count),
+                     [&](const PushRule x, const PushRule y) { return score(x) > score(y); });
+}
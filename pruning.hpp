@@ -0,0 +1,107 @@
+#ifndef PRUNING_HPP
+#define PRUNING_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "bruteforce.hpp"
+
+/// Parses a rule from its number, as in the comments of rejecting_rule, or from its label, e.g. "5" or "duplicate".
+[[nodiscard]] std::optional<PushRule> push_rule_parse(std::string_view str) noexcept;
+
+/// The rules of can_push as a pipeline of rules which can be disabled and reordered at runtime.
+/// Reordering never changes which candidates are rejected, only how quickly, since every rule is independent of the
+/// others. Disabling rules lets through programs which are not canonical, so that the search finds them as well.
+///
+/// An adaptive pipeline samples the candidates it tests at regular intervals, and evaluates every enabled rule on the
+/// samples, measuring the rate at which it rejects them and the time it takes. It periodically sorts its rules by
+/// rejection rate divided by cost, so that cheap rules which reject many candidates come first.
+class PruningPipeline {
+public:
+    /// the candidates between two samples
+    static constexpr std::uint64_t SAMPLE_INTERVAL = 4096;
+    /// the samples between two reorderings
+    static constexpr std::uint64_t REORDER_INTERVAL = 64;
+    /// the evaluations of a rule which are timed together, so that the clock is read less often than the rule
+    static constexpr unsigned TIMED_EVALUATIONS = 4;
+
+private:
+    /// the enabled rules in the order in which they are tested, followed by the disabled ones
+    std::array<PushRule, PUSH_RULE_COUNT> rules;
+    std::size_t enabled_count = PUSH_RULE_COUNT;
+    bool adaptive;
+
+    std::uint64_t next_sample = SAMPLE_INTERVAL;
+    std::uint64_t samples = 0;
+    /// the rejections and time of each rule on the samples, indexed by the rule minus one
+    std::array<std::uint64_t, PUSH_RULE_COUNT> sampled_rejections{};
+    std::array<std::chrono::nanoseconds, PUSH_RULE_COUNT> sampled_time{};
+
+public:
+    /// Creates a pipeline of all rules in the order of can_push.
+    explicit PruningPipeline(bool adaptive = true) noexcept;
+
+    void set_enabled(PushRule rule, bool enabled) noexcept;
+
+    [[nodiscard]] bool is_enabled(PushRule rule) const noexcept;
+
+    /// Returns the enabled rules, in the order in which they are currently tested.
+    [[nodiscard]] const PushRule *begin() const noexcept
+    {
+        return rules.data();
+    }
+
+    [[nodiscard]] const PushRule *end() const noexcept
+    {
+        return rules.data() + enabled_count;
+    }
+
+    /// Returns the first enabled rule which rejects pushing the instruction, or PushRule::NONE if it can be pushed.
+    template <bool Unary>
+    [[nodiscard]] PushRule rejecting_rule(const CanonicalProgram &program, const CanonicalInstruction ins) noexcept
+    {
+        if (program.empty()) {
+            return PushRule::NONE;
+        }
+        if (adaptive && --next_sample == 0) {
+            sample<Unary>(program, ins);
+        }
+        for (std::size_t i = 0; i < enabled_count; ++i) {
+            if (rule_rejects<Unary>(rules[i], program, ins)) {
+                return rules[i];
+            }
+        }
+        return PushRule::NONE;
+    }
+
+private:
+    template <bool Unary>
+    void sample(const CanonicalProgram &program, const CanonicalInstruction ins) noexcept
+    {
+        next_sample = SAMPLE_INTERVAL;
+        for (std::size_t i = 0; i < enabled_count; ++i) {
+            const PushRule rule = rules[i];
+            const std::size_t index = static_cast<std::size_t>(rule) - 1;
+
+            // reading the program through a volatile pointer keeps the evaluations from being merged into one
+            const CanonicalProgram *volatile opaque = &program;
+            bool rejected = false;
+            const auto start = std::chrono::steady_clock::now();
+            for (unsigned j = 0; j < TIMED_EVALUATIONS; ++j) {
+                rejected = rule_rejects<Unary>(rule, *opaque, ins);
+            }
+            sampled_time[index] += std::chrono::steady_clock::now() - start;
+            sampled_rejections[index] += rejected;
+        }
+        if (++samples % REORDER_INTERVAL == 0) {
+            reorder();
+        }
+    }
+
+    void reorder() noexcept;
+};
+
+#endif  // PRUNING_HPP
@@ -0,0 +1,87 @@
+#ifndef RESULT_HPP
+#define RESULT_HPP
+
+#include <string>
+#include <utility>
+#include <variant>
+
+enum class ErrorCode : unsigned char {
+    /// a truth table of the wrong length or with invalid characters
+    INVALID_TRUTH_TABLE,
+    /// an expression which cannot be tokenized or parsed
+    SYNTAX_ERROR,
+    /// an expression without any variables
+    NO_VARIABLES,
+    /// an input which exceeds the limits of programs
+    TOO_LARGE,
+    /// a malformed or unsupported netlist file
+    INVALID_NETLIST,
+    /// a request which the library does not support (yet)
+    UNSUPPORTED,
+    /// a search which reached its deadline, node budget or cancellation before it could finish
+    LIMIT_REACHED,
+    /// a broken invariant of the library itself
+    INTERNAL,
+};
+
+/// an error which the library returns to its caller, instead of printing it and exiting
+struct Error {
+    ErrorCode code;
+    /// a human readable description without a trailing newline, which may span multiple lines
+    std::string message;
+};
+
+/// Either a value or the error which prevented it from being computed.
+template <typename T>
+class [[nodiscard]] Result {
+private:
+    std::variant<T, Error> value_or_error;
+
+public:
+    Result(T value) : value_or_error{std::in_place_index<0>, std::move(value)} {}
+
+    Result(Error error) : value_or_error{std::in_place_index<1>, std::move(error)} {}
+
+    [[nodiscard]] bool has_value() const noexcept
+    {
+        return value_or_error.index() == 0;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return has_value();
+    }
+
+    [[nodiscard]] T &operator*() & noexcept
+    {
+        return *std::get_if<0>(&value_or_error);
+    }
+
+    [[nodiscard]] const T &operator*() const & noexcept
+    {
+        return *std::get_if<0>(&value_or_error);
+    }
+
+    [[nodiscard]] T &&operator*() && noexcept
+    {
+        return std::move(*std::get_if<0>(&value_or_error));
+    }
+
+    [[nodiscard]] T *operator->() noexcept
+    {
+        return std::get_if<0>(&value_or_error);
+    }
+
+    [[nodiscard]] const T *operator->() const noexcept
+    {
+        return std::get_if<0>(&value_or_error);
+    }
+
+    /// Returns the error, only valid if there is no value.
+    [[nodiscard]] const Error &error() const noexcept
+    {
+        return *std::get_if<1>(&value_or_error);
+    }
+};
+
+#endif  // RESULT_HPP
@@ -0,0 +1,408 @@
+#include <algorithm>
+#include <array>
+
+#include "resynthesis.hpp"
+#include "trace.hpp"
+
+namespace {
+
+/// a set of leaves which separates a gate from the inputs, sorted by operand index
+struct Cut {
+    std::array<std::uint32_t, VARIABLE_COUNT> leaves;
+    std::uint8_t size;
+
+    bool operator==(const Cut &other) const noexcept
+    {
+        return size == other.size && std::equal(leaves.begin(), leaves.begin() + size, other.leaves.begin());
+    }
+
+    [[nodiscard]] bool contains(const std::uint32_t operand) const noexcept
+    {
+        return std::find(leaves.begin(), leaves.begin() + size, operand) != leaves.begin() + size;
+    }
+};
+
+/// Merges two cuts into the result, unless the merged cut would have more leaves than the limit.
+[[nodiscard]] bool merge_cuts(const Cut &x, const Cut &y, const unsigned limit, Cut &result) noexcept
+{
+    unsigned i = 0, j = 0, size = 0;
+    while (i < x.size || j < y.size) {
+        std::uint32_t next;
+        if (j == y.size || (i < x.size && x.leaves[i] < y.leaves[j])) {
+            next = x.leaves[i++];
+        }
+        else if (i == x.size || y.leaves[j] < x.leaves[i]) {
+            next = y.leaves[j++];
+        }
+        else {
+            next = x.leaves[i++];
+            ++j;
+        }
+        if (size == limit) {
+            return false;
+        }
+        result.leaves[size++] = next;
+    }
+    result.size = static_cast<std::uint8_t>(size);
+    return true;
+}
+
+/// collects the first program found
+struct FirstProgramConsumer : public ProgramConsumer {
+    std::vector<Instruction> instructions;
+
+    void operator()(const Instruction *ins, const std::size_t count) final
+    {
+        instructions.assign(ins, ins + count);
+    }
+};
+
+/// the number of gates needed to implement a program inside of a netlist
+[[nodiscard]] std::size_t gate_cost(const std::vector<Instruction> &program) noexcept
+{
+    const bool is_mov = program.size() == 1 && static_cast<Op>(program.front().op) == Op::A;
+    return is_mov ? 0 : program.size();
+}
+
+class Resynthesizer {
+private:
+    struct Replacement {
+        Cut cut;
+        const std::vector<Instruction> *program = nullptr;
+    };
+
+    Netlist &netlist;
+    ResynthesisCache &cache;
+    const ResynthesisOptions &options;
+    ResynthesisStats &stats;
+
+    /// the cuts of every operand, where the last cut of each gate is the trivial cut
+    /// and where constant gates also have an empty cut
+    std::vector<std::vector<Cut>> cuts;
+    /// the number of references to every operand
+    std::vector<std::uint32_t> refs;
+    std::vector<Replacement> replacements;
+
+    /// the values of operands during cut evaluation, which are only valid if their stamp is the current stamp
+    std::vector<std::uint64_t> values;
+    std::vector<std::uint32_t> stamps;
+    std::uint32_t stamp = 0;
+
+public:
+    Resynthesizer(Netlist &netlist,
+                  ResynthesisCache &cache,
+                  const ResynthesisOptions &options,
+                  ResynthesisStats &stats) noexcept
+        : netlist{netlist}, cache{cache}, options{options}, stats{stats}
+    {
+    }
+
+    /// Performs a single rewriting pass and returns true if any cut was replaced.
+    bool pass()
+    {
+        const std::uint32_t count = netlist.operand_count();
+        replacements.assign(count, {});
+        values.assign(count, 0);
+        stamps.assign(count, 0);
+        stamp = 0;
+
+        compute_refs();
+        compute_cuts();
+
+        std::size_t replaced = 0;
+        for (std::uint32_t i = netlist.inputs; i < count; ++i) {
+            if (refs[i] != 0) {
+                replaced += try_replace(i);
+            }
+        }
+        if (replaced == 0) {
+            return false;
+        }
+        stats.replacements += replaced;
+        netlist = rebuild();
+        return true;
+    }
+
+private:
+    void compute_refs()
+    {
+        refs.assign(netlist.operand_count(), 0);
+        for (std::uint32_t i = 0; i < netlist.gate_count(); ++i) {
+            const Op op = static_cast<Op>(netlist.ops[i]);
+            refs[netlist.operands_a[i]] += op_uses_a(op);
+            refs[netlist.operands_b[i]] += op_uses_b(op);
+        }
+        for (const std::uint32_t output : netlist.outputs) {
+            ++refs[output];
+        }
+    }
+
+    void compute_cuts()
+    {
+        const unsigned limit = std::min(options.cut_size, VARIABLE_COUNT);
+
+        cuts.assign(netlist.operand_count(), {});
+        for (std::uint32_t i = 0; i < netlist.inputs; ++i) {
+            cuts[i].push_back({{i}, 1});
+        }
+        for (std::uint32_t i = netlist.inputs; i < netlist.operand_count(); ++i) {
+            const Gate gate = netlist.gate(i);
+            const Op op = static_cast<Op>(gate.op);
+            std::vector<Cut> &result = cuts[i];
+
+            if (not op_uses_a(op) && not op_uses_b(op)) {
+                // constants don't need any leaves, which lets them vanish into the cuts of other gates
+                result.push_back({{}, 0});
+            }
+            else if (op_uses_a(op) != op_uses_b(op)) {
+                result = cuts[op_uses_a(op) ? gate.a : gate.b];
+            }
+            else if (op_uses_a(op)) {
+                for (const Cut &x : cuts[gate.a]) {
+                    for (const Cut &y : cuts[gate.b]) {
+                        Cut merged;
+                        if (merge_cuts(x, y, limit, merged) &&
+                            std::find(result.begin(), result.end(), merged) == result.end()) {
+                            result.push_back(merged);
+                        }
+                    }
+                }
+            }
+
+            std::stable_sort(result.begin(), result.end(), [](const Cut &x, const Cut &y) {
+                return x.size < y.size;
+            });
+            if (result.size() > options.cuts_per_gate) {
+                result.resize(options.cuts_per_gate);
+            }
+            result.push_back({{i}, 1});
+        }
+    }
+
+    /// Computes the truth table of the root in terms of the cut leaves, or returns false if the cone of the cut
+    /// contains a gate which is already being replaced.
+    bool evaluate_cut(const std::uint32_t root, const Cut &cut, std::uint64_t &result)
+    {
+        ++stamp;
+        for (unsigned i = 0; i < cut.size; ++i) {
+            values[cut.leaves[i]] = VARIABLE_ROWS[i];
+            stamps[cut.leaves[i]] = stamp;
+        }
+        bool valid = true;
+        result = evaluate(root, root, valid) & truth_table_rows(cut.size);
+        return valid;
+    }
+
+    std::uint64_t evaluate(const std::uint32_t operand, const std::uint32_t root, bool &valid)
+    {
+        if (stamps[operand] == stamp) {
+            return values[operand];
+        }
+        if (netlist.is_input(operand) || (operand != root && replacements[operand].program != nullptr)) {
+            valid = false;
+            return 0;
+        }
+        const Gate gate = netlist.gate(operand);
+        const Op op = static_cast<Op>(gate.op);
+        const std::uint64_t a = op_uses_a(op) ? evaluate(gate.a, root, valid) : 0;
+        const std::uint64_t b = op_uses_b(op) ? evaluate(gate.b, root, valid) : 0;
+        stamps[operand] = stamp;
+        return values[operand] = op_apply(op, a, b);
+    }
+
+    /// Removes the references of a gate to its operands, and recursively those of operands which become unused.
+    /// Returns the number of gates which become unused, including the gate itself.
+    std::size_t deref(const std::uint32_t operand, const Cut &cut)
+    {
+        std::size_t result = 1;
+        const Gate gate = netlist.gate(operand);
+        const Op op = static_cast<Op>(gate.op);
+        for (const auto [used, o] : {pair<bool, std::uint32_t>{op_uses_a(op), gate.a}, {op_uses_b(op), gate.b}}) {
+            if (used && --refs[o] == 0 && not netlist.is_input(o) && not cut.contains(o)) {
+                result += deref(o, cut);
+            }
+        }
+        return result;
+    }
+
+    /// Undoes deref.
+    void ref(const std::uint32_t operand, const Cut &cut)
+    {
+        const Gate gate = netlist.gate(operand);
+        const Op op = static_cast<Op>(gate.op);
+        for (const auto [used, o] : {pair<bool, std::uint32_t>{op_uses_a(op), gate.a}, {op_uses_b(op), gate.b}}) {
+            if (used && refs[o]++ == 0 && not netlist.is_input(o) && not cut.contains(o)) {
+                ref(o, cut);
+            }
+        }
+    }
+
+    /// Replaces the gate with the optimal program of whichever of its cuts saves the most gates.
+    bool try_replace(const std::uint32_t root)
+    {
+        const std::vector<Cut> &root_cuts = cuts[root];
+        const std::vector<Instruction> *best_program = nullptr;
+        std::size_t best_cut = 0;
+        std::size_t best_gain = 0;
+
+        // the last cut is the trivial one, which can't be replaced
+        for (std::size_t i = 0; i + 1 < root_cuts.size(); ++i) {
+            const Cut &cut = root_cuts[i];
+            std::uint64_t table;
+            if (cut.size == 0 || not evaluate_cut(root, cut, table)) {
+                continue;
+            }
+            const ResynthesisCache::Entry &entry = cache.find({table, table}, cut.size, options.cut_limits, stats);
+            if (not entry.found) {
+                continue;
+            }
+
+            const std::size_t freed = deref(root, cut);
+            ref(root, cut);
+            const std::size_t cost = gate_cost(entry.instructions);
+            if (freed > cost && freed - cost > best_gain) {
+                best_program = &entry.instructions;
+                best_cut = i;
+                best_gain = freed - cost;
+            }
+        }
+        if (best_program == nullptr) {
+            return false;
+        }
+
+        const Cut &cut = root_cuts[best_cut];
+        deref(root, cut);
+        for (const Instruction &ins : *best_program) {
+            const Op op = static_cast<Op>(ins.op);
+            for (const auto [used, o] : {pair<bool, unsigned>{op_uses_a(op), ins.a}, {op_uses_b(op), ins.b}}) {
+                if (used && o < VARIABLE_COUNT) {
+                    ++refs[cut.leaves[o]];
+                }
+            }
+        }
+        replacements[root] = {cut, best_program};
+        return true;
+    }
+
+    /// Builds the netlist with all replacements applied and with identical gates merged.
+    Netlist rebuild()
+    {
+        const std::uint32_t count = netlist.operand_count();
+
+        std::vector<bool> needed(count);
+        for (const std::uint32_t output : netlist.outputs) {
+            needed[output] = true;
+        }
+        for (std::uint32_t i = count; i-- > netlist.inputs;) {
+            if (not needed[i]) {
+                continue;
+            }
+            if (const Replacement &r = replacements[i]; r.program != nullptr) {
+                for (unsigned j = 0; j < r.cut.size; ++j) {
+                    needed[r.cut.leaves[j]] = true;
+                }
+                continue;
+            }
+            const Gate gate = netlist.gate(i);
+            const Op op = static_cast<Op>(gate.op);
+            needed[gate.a] = needed[gate.a] || op_uses_a(op);
+            needed[gate.b] = needed[gate.b] || op_uses_b(op);
+        }
+
+        Netlist result;
+        result.inputs = netlist.inputs;
+        result.input_names = std::move(netlist.input_names);
+        result.output_names = std::move(netlist.output_names);
+        result.reserve(netlist.gate_count());
+
+        std::unordered_map<std::uint64_t, std::uint32_t> existing[16];
+        const auto emit = [&](const Op op, std::uint32_t a, std::uint32_t b) {
+            a = op_uses_a(op) ? a : 0;
+            b = op_uses_b(op) ? b : 0;
+            if (op_is_commutative(op) && b < a) {
+                std::swap(a, b);
+            }
+            const std::uint64_t key = std::uint64_t{a} << 32 | b;
+            const auto [it, inserted] = existing[to_underlying(op)].try_emplace(key, 0);
+            if (inserted) {
+                it->second = result.push(op, a, b);
+            }
+            return it->second;
+        };
+
+        std::vector<std::uint32_t> renamed(count);
+        for (std::uint32_t i = 0; i < netlist.inputs; ++i) {
+            renamed[i] = i;
+        }
+        std::vector<std::uint32_t> local;
+        for (std::uint32_t i = netlist.inputs; i < count; ++i) {
+            if (not needed[i]) {
+                continue;
+            }
+            const Replacement &r = replacements[i];
+            if (r.program == nullptr) {
+                const Gate gate = netlist.gate(i);
+                renamed[i] = emit(static_cast<Op>(gate.op), renamed[gate.a], renamed[gate.b]);
+                continue;
+            }
+
+            local.clear();
+            const auto operand = [&](const unsigned o) {
+                return o < VARIABLE_COUNT ? renamed[r.cut.leaves[o]] : local[o - VARIABLE_COUNT];
+            };
+            for (const Instruction &ins : *r.program) {
+                const Op op = static_cast<Op>(ins.op);
+                const std::uint32_t a = op_uses_a(op) ? operand(ins.a) : 0;
+                const std::uint32_t b = op_uses_b(op) ? operand(ins.b) : 0;
+                local.push_back(op == Op::A ? a : op == Op::B ? b : emit(op, a, b));
+            }
+            renamed[i] = local.back();
+        }
+
+        result.outputs.reserve(netlist.outputs.size());
+        for (const std::uint32_t output : netlist.outputs) {
+            result.outputs.push_back(renamed[output]);
+        }
+        return result;
+    }
+};
+
+}  // namespace
+
+const ResynthesisCache::Entry &ResynthesisCache::find(const TruthTable table,
+                                                      const std::size_t variables,
+                                                      const SearchLimits &limits,
+                                                      ResynthesisStats &stats)
+{
+    std::unordered_map<std::uint64_t, Entry> &map = entries[variables];
+    const auto it = map.find(table.f);
+    if (it != map.end() && (not it->second.stopped || limits.node_budget <= it->second.nodes)) {
+        ++stats.cache_hits;
+        return it->second;
+    }
+    ++stats.cache_misses;
+
+    FirstProgramConsumer consumer;
+    const SearchResult result = find_equivalent_programs(consumer, table, InstructionSet::C, variables, false, limits);
+    Entry entry{result.found(), std::move(consumer.instructions), result.status == SearchStatus::STOPPED, result.nodes};
+    // only entries of stopped searches are replaced, and those are never referred to by their callers
+    return map.insert_or_assign(table.f, std::move(entry)).first->second;
+}
+
+ResynthesisStats resynthesize(Netlist &netlist, ResynthesisCache &cache, const ResynthesisOptions &options)
+{
+    const TraceScope trace{"resynthesize", "gates", netlist.gate_count()};
+    ResynthesisStats stats;
+    stats.initial_gates = netlist.gate_count();
+    netlist = remove_dead_gates(netlist);
+
+    Resynthesizer resynthesizer{netlist, cache, options, stats};
+    while (stats.passes < options.max_passes) {
+        ++stats.passes;
+        if (not resynthesizer.pass()) {
+            break;
+        }
+    }
+    stats.final_gates = netlist.gate_count();
+    return stats;
+}
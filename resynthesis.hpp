@@ -0,0 +1,67 @@
+#ifndef RESYNTHESIS_HPP
+#define RESYNTHESIS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "netlist.hpp"
+#include "program.hpp"
+
+struct ResynthesisOptions {
+    /// the maximum number of leaves of a cut, at most 6
+    unsigned cut_size = 4;
+    /// the maximum number of cuts kept per gate, in addition to the trivial cut
+    unsigned cuts_per_gate = 8;
+    /// the maximum number of rewriting passes
+    std::size_t max_passes = 64;
+    /// the limits for finding the optimal program of a single cut, cuts whose search is stopped are left alone
+    SearchLimits cut_limits{std::chrono::steady_clock::time_point::max(), std::uint64_t{1} << 20, nullptr};
+};
+
+struct ResynthesisStats {
+    std::size_t initial_gates = 0;
+    std::size_t final_gates = 0;
+    std::size_t passes = 0;
+    std::size_t replacements = 0;
+    std::size_t cache_hits = 0;
+    std::size_t cache_misses = 0;
+};
+
+/// Remembers the optimal programs of cut functions, so that recurring functions are only searched for once.
+/// A cache can be shared between many netlists.
+/// Searches which stopped at their limits are searched again when they are looked up with a larger node budget than
+/// they had, so that a cache shared between calls with different limits never keeps a function unsolved for good.
+class ResynthesisCache {
+public:
+    struct Entry {
+        /// false if the search hit its limits before finding a program
+        bool found;
+        std::vector<Instruction> instructions;
+        /// true if the search hit its limits, in which case the entry is only valid for budgets of at most its nodes
+        bool stopped = false;
+        /// the number of nodes the search visited
+        std::uint64_t nodes = 0;
+    };
+
+    const Entry &find(TruthTable table, std::size_t variables, const SearchLimits &limits, ResynthesisStats &stats);
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        std::size_t result = 0;
+        for (const auto &map : entries) {
+            result += map.size();
+        }
+        return result;
+    }
+
+private:
+    std::unordered_map<std::uint64_t, Entry> entries[VARIABLE_COUNT + 1];
+};
+
+/// Repeatedly replaces cuts of at most six inputs with their optimal programs wherever that saves gates, until no
+/// replacement saves gates anymore.
+ResynthesisStats resynthesize(Netlist &netlist, ResynthesisCache &cache, const ResynthesisOptions &options = {});
+
+#endif  // RESYNTHESIS_HPP
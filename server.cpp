@@ -0,0 +1,652 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "boolexpr.hpp"
+#include "isomorphism.hpp"
+#include "lexer.hpp"
+
+#include "server.hpp"
+
+namespace {
+
+/// the longest query which is accepted, longer lines close the connection
+constexpr std::size_t MAX_QUERY_LENGTH = std::size_t{1} << 20;
+
+/// the write end of the pipe which wakes up the event loop, global so that signal handlers can use it
+int wake_fd = -1;
+volatile std::sig_atomic_t stop_signal = 0;
+
+void on_stop_signal(int) noexcept
+{
+    stop_signal = 1;
+    const char byte = 0;
+    [[maybe_unused]] const ssize_t written = write(wake_fd, &byte, 1);
+}
+
+/// Writes all bytes to the socket, returns false if the peer is gone.
+bool send_all(const int fd, const std::string_view data) noexcept
+{
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+[[nodiscard]] std::optional<sockaddr_un> socket_address(const std::string &path) noexcept
+{
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        return std::nullopt;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+/// the shortest programs of the most recently queried tables, shared by all workers
+/// Every shard evicts its least recently used table once it holds its share of the capacity.
+class SynthesisCache {
+private:
+    static constexpr std::size_t shard_count = 16;
+
+    struct Key {
+        std::uint64_t f;
+        std::uint64_t t;
+        std::size_t variables;
+
+        bool operator==(const Key &other) const noexcept
+        {
+            return f == other.f && t == other.t && variables == other.variables;
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const noexcept
+        {
+            return mix_hash(key.f ^ mix_hash(key.t + key.variables));
+        }
+    };
+
+    struct Entry {
+        Key key;
+        std::vector<Instruction> program;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        /// the entries from the most to the least recently used
+        std::list<Entry> entries;
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    };
+
+    Shard shards[shard_count];
+    std::size_t shard_capacity;
+
+public:
+    std::atomic<std::uint64_t> hits{0};
+    std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint64_t> evictions{0};
+
+    /// Creates a cache of at most the given number of tables, which caches nothing if it is zero.
+    explicit SynthesisCache(const std::size_t capacity) noexcept
+        : shard_capacity{(capacity + shard_count - 1) / shard_count}
+    {
+    }
+
+    [[nodiscard]] std::optional<std::vector<Instruction>> find(const TruthTable table, const std::size_t variables)
+    {
+        const Key key{table.f, table.t, variables};
+        Shard &shard = shards[KeyHash{}(key) % shard_count];
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        if (const auto it = shard.index.find(key); it != shard.index.end()) {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            return it->second->program;
+        }
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    void insert(const TruthTable table, const std::size_t variables, std::vector<Instruction> program)
+    {
+        if (shard_capacity == 0) {
+            return;
+        }
+        const Key key{table.f, table.t, variables};
+        Shard &shard = shards[KeyHash{}(key) % shard_count];
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        // another worker may have searched the same table in the meantime
+        if (shard.index.count(key) != 0) {
+            return;
+        }
+        shard.entries.push_front({key, std::move(program)});
+        shard.index.emplace(key, shard.entries.begin());
+        if (shard.entries.size() > shard_capacity) {
+            shard.index.erase(shard.entries.back().key);
+            shard.entries.pop_back();
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    [[nodiscard]] std::size_t size()
+    {
+        std::size_t result = 0;
+        for (Shard &shard : shards) {
+            std::lock_guard<std::mutex> lock{shard.mutex};
+            result += shard.entries.size();
+        }
+        return result;
+    }
+};
+
+/// the latencies of the most recent queries, from which percentiles are computed on demand
+class LatencyWindow {
+private:
+    static constexpr std::size_t capacity = 8192;
+
+    std::mutex mutex;
+    std::vector<std::uint64_t> micros;
+    std::size_t next = 0;
+
+public:
+    void record(const std::chrono::steady_clock::duration latency)
+    {
+        const auto value = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+        std::lock_guard<std::mutex> lock{mutex};
+        if (micros.size() < capacity) {
+            micros.push_back(value);
+        }
+        else {
+            micros[next] = value;
+            next = (next + 1) % capacity;
+        }
+    }
+
+    /// Returns the given percentiles of the window in microseconds, all zero if it is empty.
+    template <std::size_t N>
+    [[nodiscard]] std::array<std::uint64_t, N> percentiles(const std::array<unsigned, N> &ranks)
+    {
+        std::vector<std::uint64_t> sorted;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            sorted = micros;
+        }
+        std::sort(sorted.begin(), sorted.end());
+        std::array<std::uint64_t, N> result{};
+        for (std::size_t i = 0; i < N && not sorted.empty(); ++i) {
+            result[i] = sorted[std::min(sorted.size() - 1, sorted.size() * ranks[i] / 100)];
+        }
+        return result;
+    }
+};
+
+/// keeps the first program it is given
+struct FirstProgramConsumer : public ProgramConsumer {
+    std::vector<Instruction> program;
+
+    void operator()(const Instruction *ins, const std::size_t count) final
+    {
+        if (program.empty()) {
+            program.assign(ins, ins + count);
+        }
+    }
+};
+
+struct Job {
+    int fd;
+    std::string query;
+    std::chrono::steady_clock::time_point received;
+};
+
+class Server {
+private:
+    const ServerOptions &options;
+    int listen_fd = -1;
+    int wake_read_fd = -1;
+
+    struct Client {
+        std::string input;
+        /// true while a worker answers a query of the client, during which nothing else is read from it
+        bool busy = false;
+        /// true once the client closed its end of the connection
+        bool hung_up = false;
+    };
+    std::unordered_map<int, Client> clients;
+
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::deque<Job> jobs;
+    /// the clients whose queries were answered, which the event loop has to read from again
+    std::vector<int> finished;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    CancellationToken cancellation;
+    SynthesisCache cache;
+    LatencyWindow latencies;
+    std::atomic<std::uint64_t> queries{0};
+    std::atomic<std::uint64_t> errors{0};
+
+public:
+    explicit Server(const ServerOptions &options) noexcept : options{options}, cache{options.cache_capacity} {}
+
+    ~Server()
+    {
+        stop_workers();
+        for (const auto &[fd, client] : clients) {
+            close(fd);
+        }
+        for (const int fd : {listen_fd, wake_read_fd, wake_fd}) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+        wake_fd = -1;
+        if (listen_fd != -1) {
+            unlink(options.socket_path.c_str());
+        }
+    }
+
+    [[nodiscard]] bool listen()
+    {
+        const std::optional<sockaddr_un> address = socket_address(options.socket_path);
+        if (not address.has_value()) {
+            std::cout << "Socket path \"" << options.socket_path << "\" is too long\n";
+            return false;
+        }
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0) {
+            std::cout << "Failed to create pipe: " << std::strerror(errno) << '\n';
+            return false;
+        }
+        wake_read_fd = pipe_fds[0];
+        wake_fd = pipe_fds[1];
+        // a full pipe already wakes the event loop, so writers never have to wait for it
+        for (const int fd : pipe_fds) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+
+        listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd == -1) {
+            std::cout << "Failed to create socket: " << std::strerror(errno) << '\n';
+            return false;
+        }
+        unlink(options.socket_path.c_str());
+        if (bind(listen_fd, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)) != 0 ||
+            ::listen(listen_fd, SOMAXCONN) != 0) {
+            std::cout << "Failed to listen on \"" << options.socket_path << "\": " << std::strerror(errno) << '\n';
+            close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+
+        const unsigned threads = options.threads != 0 ? options.threads : std::thread::hardware_concurrency();
+        for (unsigned i = 0; i < std::max(1u, threads); ++i) {
+            workers.emplace_back(&Server::work, this);
+        }
+        std::cerr << "Serving on " << options.socket_path << " with " << workers.size() << " threads\n";
+        return true;
+    }
+
+    void run()
+    {
+        std::vector<pollfd> fds;
+        while (stop_signal == 0 && not is_stopping()) {
+            fds.clear();
+            fds.push_back({wake_read_fd, POLLIN, 0});
+            fds.push_back({listen_fd, POLLIN, 0});
+            for (const auto &[fd, client] : clients) {
+                if (not client.busy) {
+                    fds.push_back({fd, POLLIN, 0});
+                }
+            }
+
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cout << "Failed to poll: " << std::strerror(errno) << '\n';
+                return;
+            }
+
+            if (fds[0].revents != 0) {
+                char drain[64];
+                [[maybe_unused]] const ssize_t n = read(wake_read_fd, drain, sizeof(drain));
+                resume_finished_clients();
+            }
+            if (fds[1].revents != 0) {
+                accept_client();
+            }
+            for (std::size_t i = 2; i < fds.size(); ++i) {
+                if (fds[i].revents != 0) {
+                    read_client(fds[i].fd);
+                }
+            }
+        }
+    }
+
+private:
+    [[nodiscard]] bool is_stopping()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        return stopping;
+    }
+
+    void stop_workers()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        cancellation.cancel();
+        work_available.notify_all();
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    void accept_client()
+    {
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd != -1) {
+            clients.emplace(fd, Client{});
+        }
+    }
+
+    void close_client(const int fd)
+    {
+        close(fd);
+        clients.erase(fd);
+    }
+
+    void read_client(const int fd)
+    {
+        Client &client = clients.at(fd);
+        char buffer[1 << 16];
+        const ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            client.hung_up = true;
+        }
+        else {
+            client.input.append(buffer, static_cast<std::size_t>(n));
+        }
+        dispatch(fd, client);
+    }
+
+    /// Hands the next complete query of an idle client to the workers, or closes the client if it is done.
+    void dispatch(const int fd, Client &client)
+    {
+        const std::size_t end = client.input.find('\n');
+        if (end == std::string::npos) {
+            if (client.input.size() > MAX_QUERY_LENGTH) {
+                send_all(fd, "error query too long\n");
+                close_client(fd);
+            }
+            else if (client.hung_up) {
+                close_client(fd);
+            }
+            return;
+        }
+
+        std::string query = client.input.substr(0, end);
+        client.input.erase(0, end + 1);
+        if (not query.empty() && query.back() == '\r') {
+            query.pop_back();
+        }
+        client.busy = true;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            jobs.push_back({fd, std::move(query), std::chrono::steady_clock::now()});
+        }
+        work_available.notify_one();
+    }
+
+    void resume_finished_clients()
+    {
+        std::vector<int> resumed;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            resumed.swap(finished);
+        }
+        for (const int fd : resumed) {
+            Client &client = clients.at(fd);
+            client.busy = false;
+            dispatch(fd, client);
+        }
+    }
+
+    void work()
+    {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                work_available.wait(lock, [this] { return stopping || not jobs.empty(); });
+                if (stopping) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            const std::string response = answer(job.query);
+            send_all(job.fd, response);
+            latencies.record(std::chrono::steady_clock::now() - job.received);
+
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                finished.push_back(job.fd);
+            }
+            const char byte = 0;
+            [[maybe_unused]] const ssize_t written = write(wake_fd, &byte, 1);
+        }
+    }
+
+    [[nodiscard]] std::string error_response(const Error &error)
+    {
+        errors.fetch_add(1, std::memory_order_relaxed);
+        // multi-line messages point at the error in the query, which the client already knows
+        return "error " + error.message.substr(0, error.message.find('\n')) + '\n';
+    }
+
+    [[nodiscard]] std::string answer(const std::string_view query)
+    {
+        queries.fetch_add(1, std::memory_order_relaxed);
+        if (query == "stats") {
+            return stats();
+        }
+        if (query == "shutdown") {
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                stopping = true;
+            }
+            const char byte = 0;
+            [[maybe_unused]] const ssize_t written = write(wake_fd, &byte, 1);
+            return "ok\n";
+        }
+
+        // a variable named x is an expression, but a table of a single entry
+        if (const Result<boolexpr::Table> table = boolexpr::parse_table(query);
+            table.has_value() && table->variables != 0) {
+            return synthesize(Program{table->variables}, table->table);
+        }
+
+        const Result<TokenList> tokens = tokenize(query);
+        if (not tokens.has_value()) {
+            return error_response(tokens.error());
+        }
+        const Result<Program> program = compile(*tokens, SymbolOrder::LEX_ASCENDING);
+        if (not program.has_value()) {
+            return error_response(program.error());
+        }
+        Program prototype{program->variables};
+        prototype.symbols = program->symbols;
+        return synthesize(prototype, program->compute_truth_table());
+    }
+
+    [[nodiscard]] std::string synthesize(Program program, const TruthTable table)
+    {
+        std::optional<std::vector<Instruction>> instructions = cache.find(table, program.variables);
+        if (not instructions.has_value()) {
+            SearchLimits limits;
+            limits.deadline = std::chrono::steady_clock::now() + options.query_timeout;
+            limits.node_budget = options.query_node_budget;
+            limits.cancellation = &cancellation;
+
+            FirstProgramConsumer consumer;
+            const SearchResult result =
+                find_equivalent_programs(consumer, table, InstructionSet::C, program.variables, false, limits);
+            if (not result.found()) {
+                return error_response({ErrorCode::LIMIT_REACHED,
+                                       "Search stopped at length " + std::to_string(result.length) +
+                                           ", lower bound " + std::to_string(result.lower_bound)});
+            }
+            cache.insert(table, program.variables, consumer.program);
+            instructions = std::move(consumer.program);
+        }
+
+        for (const Instruction ins : *instructions) {
+            program.push(ins);
+        }
+        std::string response = "ok ";
+        append_program_as_expression(response, program);
+        return response;
+    }
+
+    [[nodiscard]] std::string stats()
+    {
+        std::size_t queue_depth = 0;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            queue_depth = jobs.size();
+        }
+        const std::uint64_t hits = cache.hits.load(std::memory_order_relaxed);
+        const std::uint64_t misses = cache.misses.load(std::memory_order_relaxed);
+        const auto [p50, p90, p99, max] = latencies.percentiles<4>({50, 90, 99, 100});
+        const std::uint64_t hit_permille = hits + misses == 0 ? 0 : hits * 1000 / (hits + misses);
+
+        std::string response = "ok";
+        const auto field = [&response](const char *name, const std::uint64_t value) {
+            response += ' ';
+            response += name;
+            response += '=';
+            response += std::to_string(value);
+        };
+        field("queries", queries.load(std::memory_order_relaxed));
+        field("errors", errors.load(std::memory_order_relaxed));
+        field("queue_depth", queue_depth);
+        field("threads", workers.size());
+        field("cache_entries", cache.size());
+        field("cache_hits", hits);
+        field("cache_misses", misses);
+        field("cache_evictions", cache.evictions.load(std::memory_order_relaxed));
+        response += " cache_hit_rate=" + std::to_string(hit_permille / 1000) + '.' +
+                    std::to_string(hit_permille / 100 % 10) + std::to_string(hit_permille / 10 % 10) +
+                    std::to_string(hit_permille % 10);
+        field("latency_p50_us", p50);
+        field("latency_p90_us", p90);
+        field("latency_p99_us", p99);
+        field("latency_max_us", max);
+        response += '\n';
+        return response;
+    }
+};
+
+}  // namespace
+
+int serve(const ServerOptions &options)
+{
+    Server server{options};
+    if (not server.listen()) {
+        return EXIT_FAILURE;
+    }
+    std::signal(SIGINT, on_stop_signal);
+    std::signal(SIGTERM, on_stop_signal);
+    server.run();
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    return EXIT_SUCCESS;
+}
+
+int query_server(const std::string &socket_path, std::istream &in, std::ostream &out)
+{
+    const std::optional<sockaddr_un> address = socket_address(socket_path);
+    if (not address.has_value()) {
+        std::cout << "Socket path \"" << socket_path << "\" is too long\n";
+        return EXIT_FAILURE;
+    }
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1 || connect(fd, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)) != 0) {
+        std::cout << "Failed to connect to \"" << socket_path << "\": " << std::strerror(errno) << '\n';
+        if (fd != -1) {
+            close(fd);
+        }
+        return EXIT_FAILURE;
+    }
+
+    std::string line;
+    std::string response;
+    char buffer[1 << 12];
+    std::size_t buffered = 0;
+    std::size_t begin = 0;
+    while (std::getline(in, line)) {
+        if (not send_all(fd, line + '\n')) {
+            std::cout << "Connection closed by server\n";
+            close(fd);
+            return EXIT_FAILURE;
+        }
+        // every query is answered by exactly one line
+        response.clear();
+        while (true) {
+            if (begin == buffered) {
+                const ssize_t n = read(fd, buffer, sizeof(buffer));
+                if (n <= 0) {
+                    std::cout << "Connection closed by server\n";
+                    close(fd);
+                    return EXIT_FAILURE;
+                }
+                begin = 0;
+                buffered = static_cast<std::size_t>(n);
+            }
+            const char *const end = static_cast<const char *>(std::memchr(buffer + begin, '\n', buffered - begin));
+            const std::size_t stop = end == nullptr ? buffered : static_cast<std::size_t>(end - buffer) + 1;
+            response.append(buffer + begin, stop - begin);
+            begin = stop;
+            if (end != nullptr) {
+                break;
+            }
+        }
+        out << response << std::flush;
+    }
+    close(fd);
+    return EXIT_SUCCESS;
+}
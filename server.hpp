@@ -0,0 +1,42 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <string>
+
+struct ServerOptions {
+    /// the path of the Unix domain socket to listen on, which is replaced if it exists
+    std::string socket_path;
+    /// the number of worker threads which answer queries, zero for one per hardware thread
+    unsigned threads = 0;
+    /// the time after which the search for a single query gives up
+    std::chrono::milliseconds query_timeout{10'000};
+    /// the number of nodes after which the search for a single query gives up
+    std::uint64_t query_node_budget = std::numeric_limits<std::uint64_t>::max();
+    /// the number of tables whose programs are cached, beyond which the least recently used ones are evicted
+    std::size_t cache_capacity = std::size_t{1} << 20;
+};
+
+/// Answers newline-delimited queries from any number of clients on a Unix domain socket, until a client sends
+/// "shutdown" or the process receives SIGINT or SIGTERM. Every query gets exactly one line in response:
+///
+///     0110.1001            a truth table, answered with "ok <expression>" of a shortest program
+///     a & b | a & c        an expression, answered the same way with the symbols of the expression
+///     stats                answered with "ok" and live metrics as key=value pairs
+///     shutdown             answered with "ok", then the server stops
+///
+/// A query which parses as a truth table of at least two entries is a table, anything else is an expression.
+/// Failures are answered with "error <message>". The optimal programs of the most recently used tables are cached,
+/// so recurring functions are only searched for once.
+/// Returns the exit status of the process.
+[[nodiscard]] int serve(const ServerOptions &options);
+
+/// Sends every line of the input as a query to the server and writes the responses to the output.
+/// Returns the exit status of the process.
+[[nodiscard]] int query_server(const std::string &socket_path, std::istream &in, std::ostream &out);
+
+#endif  // SERVER_HPP
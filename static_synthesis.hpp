@@ -0,0 +1,159 @@
+#ifndef STATIC_SYNTHESIS_HPP
+#define STATIC_SYNTHESIS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "bruteforce.hpp"
+#include "truth_table.hpp"
+
+/// a program found during constant evaluation, which can itself be evaluated in constant expressions
+template <std::size_t Variables>
+struct StaticProgram {
+    std::array<Instruction, CanonicalProgram::instruction_count> instructions{};
+    std::size_t length = 0;
+
+    [[nodiscard]] constexpr std::size_t size() const noexcept
+    {
+        return length;
+    }
+
+    [[nodiscard]] constexpr Instruction operator[](const std::size_t i) const noexcept
+    {
+        return instructions[i];
+    }
+
+    /// Evaluates the program on every bit of the inputs at once, so that an input of type std::uint64_t holds 64
+    /// assignments of its variable. The loop over the instructions has a constant trip count, so a call with a
+    /// constexpr program is fully unrolled by the compiler.
+    template <typename T>
+    [[nodiscard]] constexpr T operator()(const std::array<T, Variables> &inputs) const noexcept
+    {
+        T values[VARIABLE_COUNT + CanonicalProgram::instruction_count]{};
+        for (std::size_t i = 0; i < Variables; ++i) {
+            values[i] = inputs[i];
+        }
+        T result{};
+        for (std::size_t i = 0; i < length; ++i) {
+            const Instruction ins = instructions[i];
+            result = op_apply(static_cast<Op>(ins.op), values[ins.a], values[ins.b]);
+            values[VARIABLE_COUNT + i] = result;
+        }
+        return result;
+    }
+};
+
+/// The depth first search of the run time finder, reduced to what constant evaluation allows: no consumers, no
+/// limits and no thread_local buffers. The first program of the shortest length is returned.
+/// The candidates of every node are those of for_each_candidate, in the same order as in the run time finder.
+/// Instead of emulating every complete program row by row, the table of each instruction is computed once when it is
+/// pushed, which keeps the search of most functions of up to four variables within the default constexpr limits.
+template <std::size_t Variables>
+class StaticProgramFinder {
+private:
+    CanonicalProgram program;
+    TruthTable table;
+    /// the truth tables of the inputs, followed by those of the instructions of the program
+    std::uint64_t tables[VARIABLE_COUNT + CanonicalProgram::instruction_count]{};
+
+public:
+    constexpr explicit StaticProgramFinder(const TruthTable table) noexcept
+        : program{0, table.relevancy(Variables)}, table{table}
+    {
+        for (std::size_t i = 0; i < Variables; ++i) {
+            tables[i] = VARIABLE_ROWS[i] & truth_table_rows(Variables);
+        }
+    }
+
+    [[nodiscard]] constexpr StaticProgram<Variables> find() noexcept
+    {
+        StaticProgram<Variables> result;
+        if (table.f == 0 || table.t == truth_table_rows(Variables)) {
+            result.instructions[0] = table.f == 0 ? FALSE_INSTRUCTION : TRUE_INSTRUCTION;
+            result.length = 1;
+            return result;
+        }
+        for (std::uint8_t i = 0; i < Variables; ++i) {
+            if (matches(tables[i])) {
+                result.instructions[0] = {static_cast<std::uint8_t>(Op::A), i, 0};
+                result.length = 1;
+                return result;
+            }
+        }
+        for (std::size_t length = 1; length <= CanonicalProgram::instruction_count; ++length) {
+            program.reset(length);
+            if (find_program()) {
+                for (std::size_t i = 0; i < program.size(); ++i) {
+                    result.instructions[i] = static_cast<Instruction>(program[i]);
+                }
+                result.length = program.size();
+                return result;
+            }
+        }
+        return result;
+    }
+
+private:
+    [[nodiscard]] constexpr bool matches(const std::uint64_t rows) const noexcept
+    {
+        return (rows & table.f) == table.f && (rows & ~table.t & truth_table_rows(Variables)) == 0;
+    }
+
+    /// Computes the table of the instruction which has just been pushed and searches all programs beginning with it.
+    constexpr bool find_program_after_push() noexcept
+    {
+        const CanonicalInstruction ins = program.top();
+        tables[VARIABLE_COUNT + program.size() - 1] = op_apply(static_cast<Op>(ins.op), tables[ins.a], tables[ins.b]);
+        if (find_program()) {
+            return true;
+        }
+        program.pop();
+        return false;
+    }
+
+    /// Completes the program with any instruction that produces the table.
+    /// The canonical rules are skipped here, because they only prune programs which also have the target length, and
+    /// testing the table of a candidate is cheaper than testing the rules.
+    template <typename F>
+    constexpr bool find_last_instruction(const unsigned operand_count, const F fix_operand) noexcept
+    {
+        return for_each_candidate<InstructionSet::C, SearchOrder::FORWARD>(
+            operand_count, fix_operand, [this](auto, const Op op, const unsigned a, const unsigned b) {
+                if (not matches(op_apply(op, tables[a], tables[b]))) {
+                    return false;
+                }
+                const auto dist = std::max(distance_from_inputs(program, a), distance_from_inputs(program, b));
+                program.push({static_cast<std::uint8_t>(op),
+                              static_cast<std::uint8_t>(a),
+                              static_cast<std::uint8_t>(b),
+                              static_cast<std::uint8_t>(dist + 1)});
+                return true;
+            });
+    }
+
+    constexpr bool find_program() noexcept
+    {
+        const auto fix_operand = [](const unsigned o) {
+            return o + (o >= Variables) * (VARIABLE_COUNT - Variables);
+        };
+        const unsigned operand_count = static_cast<unsigned>(program.size() + Variables);
+
+        if (program.size() + 1 == program.target_length()) {
+            return find_last_instruction(operand_count, fix_operand);
+        }
+
+        return for_each_candidate<InstructionSet::C, SearchOrder::FORWARD>(
+            operand_count, fix_operand, [this](const auto unary, const Op op, const unsigned a, const unsigned b) {
+                if constexpr (decltype(unary)::value) {
+                    return program.try_push(op, a) && find_program_after_push();
+                }
+                else {
+                    return program.try_push(op, a, b) && find_program_after_push();
+                }
+            });
+    }
+};
+
+#endif  // STATIC_SYNTHESIS_HPP
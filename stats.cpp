@@ -0,0 +1,101 @@
+#include <ostream>
+
+#include "stats.hpp"
+
+std::uint64_t SearchStats::total_nodes() const noexcept
+{
+    std::uint64_t result = 0;
+    for (const std::uint64_t n : nodes) {
+        result += n;
+    }
+    return result;
+}
+
+std::chrono::nanoseconds SearchStats::elapsed() const noexcept
+{
+    std::chrono::nanoseconds result{};
+    for (const LengthStats &length : lengths) {
+        result += length.elapsed;
+    }
+    return result;
+}
+
+double SearchStats::nodes_per_second() const noexcept
+{
+    const double seconds = std::chrono::duration<double>(elapsed()).count();
+    return seconds == 0 ? 0 : static_cast<double>(total_nodes()) / seconds;
+}
+
+const char *push_rule_label(const PushRule rule) noexcept
+{
+    switch (rule) {
+    case PushRule::NONE: return "none";
+    case PushRule::CANONICAL_ORDER: return "canonical_order";
+    case PushRule::DOUBLE_NEGATION: return "double_negation";
+    case PushRule::TRIVIAL_RESULT: return "trivial_result";
+    case PushRule::COMMUTATIVE_ORDER: return "commutative_order";
+    case PushRule::SUBOPTIMAL_AND_OR: return "suboptimal_and_or";
+    case PushRule::UNREVIVABLE: return "unrevivable";
+    case PushRule::DUPLICATE: return "duplicate";
+    }
+    __builtin_unreachable();
+}
+
+void print_stats(std::ostream &out, const SearchStats &stats)
+{
+    const auto micros = [](const std::chrono::nanoseconds duration) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    };
+
+    out << "Search statistics:\n";
+    out << "    nodes: " << stats.total_nodes() << " (" << static_cast<std::uint64_t>(stats.nodes_per_second())
+        << " per second)\n";
+    out << "    leaves emulated: " << stats.leaves << '\n';
+    out << "    solutions: " << stats.solutions << '\n';
+
+    out << "Nodes by depth:\n";
+    for (std::size_t depth = 0; depth < SearchStats::max_depth; ++depth) {
+        if (stats.nodes[depth] != 0) {
+            out << "    " << depth << ": " << stats.nodes[depth] << '\n';
+        }
+    }
+    out << "Rejections by rule:\n";
+    for (std::size_t i = 0; i < PUSH_RULE_COUNT; ++i) {
+        out << "    " << i + 1 << ' ' << push_rule_label(static_cast<PushRule>(i + 1)) << ": " << stats.rejections[i]
+            << '\n';
+    }
+    out << "Target lengths:\n";
+    for (const LengthStats &length : stats.lengths) {
+        out << "    " << length.length << ": " << length.nodes << " nodes in " << micros(length.elapsed) << "us\n";
+    }
+}
+
+void print_stats_json(std::ostream &out, const SearchStats &stats)
+{
+    out << "{\"nodes\":" << stats.total_nodes();
+    out << ",\"nodes_per_second\":" << static_cast<std::uint64_t>(stats.nodes_per_second());
+    out << ",\"leaves\":" << stats.leaves;
+    out << ",\"solutions\":" << stats.solutions;
+
+    // trailing depths without any nodes are left out
+    std::size_t depths = SearchStats::max_depth;
+    while (depths != 0 && stats.nodes[depths - 1] == 0) {
+        --depths;
+    }
+    out << ",\"nodes_by_depth\":[";
+    for (std::size_t depth = 0; depth < depths; ++depth) {
+        out << (depth == 0 ? "" : ",") << stats.nodes[depth];
+    }
+    out << "],\"rejections\":{";
+    for (std::size_t i = 0; i < PUSH_RULE_COUNT; ++i) {
+        out << (i == 0 ? "" : ",") << '"' << push_rule_label(static_cast<PushRule>(i + 1))
+            << "\":" << stats.rejections[i];
+    }
+    out << "},\"lengths\":[";
+    for (std::size_t i = 0; i < stats.lengths.size(); ++i) {
+        const LengthStats &length = stats.lengths[i];
+        out << (i == 0 ? "" : ",") << "{\"length\":" << length.length << ",\"nodes\":" << length.nodes
+            << ",\"nanoseconds\":" << length.elapsed.count() << '}';
+    }
+    out << "]}\n";
+}
@@ -0,0 +1,49 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "bruteforce.hpp"
+
+/// the work which a search did for one target length
+struct LengthStats {
+    std::size_t length;
+    std::uint64_t nodes;
+    std::chrono::nanoseconds elapsed;
+};
+
+/// Counters of a search, which are only kept if the search is given an instance.
+/// Searches without one are compiled without any of the counting.
+struct SearchStats {
+    static constexpr std::size_t max_depth = CanonicalProgram::instruction_count + 1;
+
+    /// the nodes visited at each depth, which is the number of instructions of the program at the node
+    std::array<std::uint64_t, max_depth> nodes{};
+    /// the candidate instructions which each rule of can_push rejected, indexed by the rule minus one
+    std::array<std::uint64_t, PUSH_RULE_COUNT> rejections{};
+    /// the programs of the target length which were emulated
+    std::uint64_t leaves = 0;
+    std::uint64_t solutions = 0;
+    /// the target lengths in the order in which they were searched
+    std::vector<LengthStats> lengths;
+
+    [[nodiscard]] std::uint64_t total_nodes() const noexcept;
+
+    [[nodiscard]] std::chrono::nanoseconds elapsed() const noexcept;
+
+    [[nodiscard]] double nodes_per_second() const noexcept;
+};
+
+[[nodiscard]] const char *push_rule_label(PushRule rule) noexcept;
+
+/// Prints the statistics as a human readable table.
+void print_stats(std::ostream &out, const SearchStats &stats);
+
+/// Prints the statistics as a single JSON object, followed by a newline.
+void print_stats_json(std::ostream &out, const SearchStats &stats);
+
+#endif  // STATS_HPP
@@ -0,0 +1,120 @@
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "trace.hpp"
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    const char *arg_name;
+    std::uint64_t arg;
+    std::int64_t start;
+    std::int64_t end;
+};
+
+/// The events of one thread. Only that thread appends to it, but the trace may be written while it is still running,
+/// so appending is guarded by an (uncontended) mutex.
+struct ThreadTrace {
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    const char *name = nullptr;
+    unsigned id = 0;
+};
+
+std::chrono::steady_clock::time_point epoch;
+
+std::mutex registry_mutex;
+/// the traces of all threads which recorded anything, which outlive their threads
+std::vector<std::shared_ptr<ThreadTrace>> registry;
+
+ThreadTrace &this_thread_trace()
+{
+    thread_local const std::shared_ptr<ThreadTrace> trace = [] {
+        auto result = std::make_shared<ThreadTrace>();
+        result->events.reserve(256);
+        std::lock_guard<std::mutex> lock{registry_mutex};
+        result->id = static_cast<unsigned>(registry.size() + 1);
+        registry.push_back(result);
+        return result;
+    }();
+    return *trace;
+}
+
+/// Writes nanoseconds as the microseconds of the trace event format.
+void write_micros(std::ostream &out, const std::int64_t nanos)
+{
+    const char fraction[4]{static_cast<char>('0' + nanos / 100 % 10),
+                           static_cast<char>('0' + nanos / 10 % 10),
+                           static_cast<char>('0' + nanos % 10),
+                           '\0'};
+    out << nanos / 1000 << '.' << fraction;
+}
+
+}  // namespace
+
+void start_tracing() noexcept
+{
+    epoch = std::chrono::steady_clock::now();
+    tracing_enabled.store(true, std::memory_order_release);
+}
+
+void set_trace_thread_name(const char *const name)
+{
+    if (tracing_enabled.load(std::memory_order_relaxed)) {
+        ThreadTrace &trace = this_thread_trace();
+        std::lock_guard<std::mutex> lock{trace.mutex};
+        trace.name = name;
+    }
+}
+
+std::int64_t trace_clock() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void trace_complete(const char *const name,
+                    const char *const arg_name,
+                    const std::uint64_t arg,
+                    const std::int64_t start,
+                    const std::int64_t end)
+{
+    ThreadTrace &trace = this_thread_trace();
+    std::lock_guard<std::mutex> lock{trace.mutex};
+    trace.events.push_back({name, arg_name, arg, start, end});
+}
+
+void write_trace(std::ostream &out)
+{
+    std::lock_guard<std::mutex> registry_lock{registry_mutex};
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    const auto begin_event = [&] {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+    for (const std::shared_ptr<ThreadTrace> &trace : registry) {
+        std::lock_guard<std::mutex> lock{trace->mutex};
+        if (trace->name != nullptr) {
+            begin_event();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trace->id
+                << ",\"args\":{\"name\":\"" << trace->name << "\"}}";
+        }
+        for (const TraceEvent &event : trace->events) {
+            begin_event();
+            out << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << trace->id << ",\"ts\":";
+            write_micros(out, event.start);
+            out << ",\"dur\":";
+            write_micros(out, event.end - event.start);
+            if (event.arg_name != nullptr) {
+                out << ",\"args\":{\"" << event.arg_name << "\":" << event.arg << '}';
+            }
+            out << '}';
+        }
+    }
+    out << "\n]}\n";
+}
@@ -0,0 +1,58 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+
+/// true while scopes are recorded, see start_tracing
+inline std::atomic<bool> tracing_enabled{false};
+
+/// Starts recording trace scopes on all threads, with timestamps relative to the time of this call.
+void start_tracing() noexcept;
+
+/// Names the calling thread in the trace, if tracing is enabled. The name must outlive the trace.
+void set_trace_thread_name(const char *name);
+
+/// Writes every scope recorded so far as a JSON object in the Chrome trace event format, which trace viewers such as
+/// Perfetto or chrome://tracing can open. Scopes which are still open when this is called are left out.
+void write_trace(std::ostream &out);
+
+/// Returns the nanoseconds since tracing was started.
+[[nodiscard]] std::int64_t trace_clock() noexcept;
+
+/// Appends a complete event to the buffer of the calling thread.
+void trace_complete(const char *name, const char *arg_name, std::uint64_t arg, std::int64_t start, std::int64_t end);
+
+/// A span of the timeline, from the construction of the scope to its destruction, on the calling thread.
+/// While tracing is disabled, a scope costs no more than one relaxed load in its constructor.
+/// The name and the optional name of a numeric argument must be string literals which need no escaping in JSON.
+class TraceScope {
+private:
+    const char *name;
+    const char *arg_name;
+    std::uint64_t arg;
+    /// the start of the span, or negative if it is not recorded
+    std::int64_t start;
+
+public:
+    explicit TraceScope(const char *name, const char *arg_name = nullptr, const std::uint64_t arg = 0) noexcept
+        : name{name}
+        , arg_name{arg_name}
+        , arg{arg}
+        , start{tracing_enabled.load(std::memory_order_relaxed) ? trace_clock() : -1}
+    {
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    ~TraceScope()
+    {
+        if (start >= 0) {
+            trace_complete(name, arg_name, arg, start, trace_clock());
+        }
+    }
+};
+
+#endif  // TRACE_HPP
@@ -1,5 +1,5 @@
 #include <algorithm>
-#include <iostream>
+#include <string>
 
 #include "constants.hpp"
 #include "util.hpp"
@@ -21,22 +21,21 @@ TruthTable TruthTable::parse(const std::string_view str) noexcept
     return {f, t};
 }
 
-bool TruthTable::is_well_formed(const std::string_view str) noexcept
+Result<TruthTable> TruthTable::try_parse(const std::string_view str)
 {
     if (str.length() > 64) {
-        std::cout << "Truth table is too long (at most 64 entries supported)\n";
-        return false;
+        return Error{ErrorCode::INVALID_TRUTH_TABLE, "Truth table is too long (at most 64 entries supported)"};
     }
     if (not is_pow_2(str.length())) {
-        std::cout << "Length of truth table has to be a power of two, is " << str.length() << '\n';
-        return false;
+        return Error{ErrorCode::INVALID_TRUTH_TABLE,
+                     "Length of truth table has to be a power of two, is " + std::to_string(str.length())};
     }
     constexpr auto is_valid_table_char = [](unsigned char c) {
-        return c == '1' || c == '0' || c == '*';
+        return c == '1' || c == '0' || c == DONT_CARE;
     };
     if (std::find_if_not(str.begin(), str.end(), is_valid_table_char) != str.end()) {
-        std::cout << "Truth table must consist of only '0', '1' and '" << DONT_CARE << "'\n";
-        return false;
+        return Error{ErrorCode::INVALID_TRUTH_TABLE,
+                     std::string{"Truth table must consist of only '0', '1' and '"} + DONT_CARE + '\''};
     }
-    return true;
+    return parse(str);
 }
@@ -1,14 +1,32 @@
 #ifndef TRUTH_TABLE_HPP
 #define TRUTH_TABLE_HPP
 
+#include <cstddef>
 #include <cstdint>
 #include <string_view>
 
 #include "constants.hpp"
+#include "result.hpp"
 #include "util.hpp"
 
+/// the rows of a truth table in which each variable is true
+inline constexpr std::uint64_t VARIABLE_ROWS[VARIABLE_COUNT]{0xaaaa'aaaa'aaaa'aaaa,
+                                                             0xcccc'cccc'cccc'cccc,
+                                                             0xf0f0'f0f0'f0f0'f0f0,
+                                                             0xff00'ff00'ff00'ff00,
+                                                             0xffff'0000'ffff'0000,
+                                                             0xffff'ffff'0000'0000};
+
+/// Returns the mask of all rows of a truth table with the given number of variables.
+[[nodiscard]] constexpr std::uint64_t truth_table_rows(const std::size_t variables) noexcept
+{
+    return variables == VARIABLE_COUNT ? ~std::uint64_t{0} : (std::uint64_t{1} << (std::uint64_t{1} << variables)) - 1;
+}
+
 struct TruthTable {
-    [[nodiscard]] static bool is_well_formed(std::string_view str) noexcept;
+    /// Parses a table of '0', '1' and don't cares after checking that it is well-formed.
+    [[nodiscard]] static Result<TruthTable> try_parse(std::string_view str);
+    /// Parses a table which is known to be well-formed.
     [[nodiscard]] static TruthTable parse(std::string_view str) noexcept;
 
     /// table where all don't cares are false
@@ -28,10 +46,12 @@ struct TruthTable {
 
     [[nodiscard]] constexpr std::uint64_t relevancy(const std::uint64_t variables) const noexcept
     {
+        // a variable is relevant if flipping it has to flip the result somewhere, regardless of the don't cares
         std::uint64_t result = 0;
         for (std::uint64_t i = 0; i < variables; ++i) {
-            auto [lo, hi] = split_bits_alternating(mandatory(), i);
-            result |= unsigned{lo != hi} << i;
+            auto [on_lo, on_hi] = split_bits_alternating(f, i);
+            auto [off_lo, off_hi] = split_bits_alternating(~t, i);
+            result |= unsigned{((on_lo & off_hi) | (off_lo & on_hi)) != 0} << i;
         }
         return result;
     }
@@ -36,7 +36,7 @@ template <typename Enum>
     return (x != 0) * (max - static_cast<unsigned>(builtin::clz(x)));
 }
 
-[[nodiscard]] inline unsigned popcount(unsigned long long x) noexcept
+[[nodiscard]] inline BOOLEXPR_POPCOUNT_CONSTEXPR unsigned popcount(unsigned long long x) noexcept
 {
     return static_cast<unsigned>(builtin::popcount(x));
 }